@@ -0,0 +1,128 @@
+#include "DocumentPrefetcher.h"
+
+#include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+#include <memory>
+
+#include "model/Document.h"
+#include "storage/SqliteStore.h"
+#include "trace/Trace.h"
+
+DocumentPrefetcher::DocumentPrefetcher(QObject* parent) : QObject(parent) {
+  CacheBudget::registerClient(this);
+}
+
+DocumentPrefetcher::~DocumentPrefetcher() {
+  CacheBudget::unregisterClient(this);
+  for (Entry& e : entries_) {
+    if (e.watcher) {
+      e.watcher->waitForFinished();
+      delete e.watcher->result();
+      delete e.watcher;
+    }
+    delete e.doc;
+  }
+}
+
+void DocumentPrefetcher::prefetch(const QStringList& paths) {
+  for (const QString& path : paths) {
+    const QFileInfo info(path);
+    if (!info.isFile()) continue;
+    auto it = entries_.find(path);
+    if (it != entries_.end()) {
+      if (it->watcher || it->modified == info.lastModified()) continue;
+      drop(path);
+    }
+
+    // The document is built and loaded on the worker, then pushed to the GUI
+    // thread before anyone else sees it.
+    QThread* gui = thread();
+    auto* watcher = new QFutureWatcher<Document*>(this);
+    connect(watcher, &QFutureWatcher<Document*>::finished, this,
+            [this, path, watcher]() { finishLoad(path, watcher); });
+    Entry e;
+    e.modified = info.lastModified();
+    e.watcher = watcher;
+    entries_.insert(path, e);
+    watcher->setFuture(QtConcurrent::run([path, gui]() -> Document* {
+      VELLUM_TRACE_SCOPE("app", "DocumentPrefetcher::load");
+      auto doc = std::make_unique<Document>();
+      if (!SqliteStore::loadFromFile(path, doc.get(), nullptr)) return nullptr;
+      doc->moveToThread(gui);
+      return doc.release();
+    }));
+  }
+}
+
+void DocumentPrefetcher::finishLoad(const QString& path, QFutureWatcher<Document*>* watcher) {
+  // take() may have finished this load already; its entry can be gone or
+  // belong to a newer load.
+  auto it = entries_.find(path);
+  if (it == entries_.end() || it->watcher != watcher) return;
+  Document* doc = watcher->result();
+  it->watcher = nullptr;
+  watcher->deleteLater();
+  if (!doc) {
+    entries_.erase(it);
+    return;
+  }
+  it->doc = doc;
+  it->bytes = doc->stats().totalBytes();
+  it->lastUse = CacheBudget::touch();
+  CacheBudget::enforce();
+  if (entries_.contains(path)) emit prefetched(path);
+}
+
+Document* DocumentPrefetcher::take(const QString& path, QObject* parent) {
+  auto it = entries_.find(path);
+  if (it == entries_.end()) return nullptr;
+  if (it->watcher) {
+    it->watcher->waitForFinished();
+    finishLoad(path, it->watcher);
+    it = entries_.find(path);
+    if (it == entries_.end()) return nullptr;
+  }
+  Document* doc = it->doc;
+  const bool stale = QFileInfo(path).lastModified() != it->modified;
+  entries_.erase(it);
+  if (stale) {
+    delete doc;
+    return nullptr;
+  }
+  doc->setParent(parent);
+  return doc;
+}
+
+void DocumentPrefetcher::drop(const QString& path) {
+  auto it = entries_.find(path);
+  if (it == entries_.end()) return;
+  delete it->doc;
+  entries_.erase(it);
+}
+
+qint64 DocumentPrefetcher::cacheBytes() const {
+  qint64 bytes = 0;
+  for (const Entry& e : entries_) bytes += e.bytes;
+  return bytes;
+}
+
+quint64 DocumentPrefetcher::oldestUse() const {
+  quint64 oldest = 0;
+  for (const Entry& e : entries_) {
+    if (e.doc && (oldest == 0 || e.lastUse < oldest)) oldest = e.lastUse;
+  }
+  return oldest;
+}
+
+void DocumentPrefetcher::evictOldest() {
+  const quint64 oldest = oldestUse();
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->doc && it->lastUse == oldest) {
+      const QString path = it.key();
+      drop(path);
+      return;
+    }
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include "cache/CacheBudget.h"
+
+class Document;
+
+// Loads documents the user is likely to open next (the recent list) on a
+// worker thread, so opening one is a pointer hand-over instead of a load.
+// Loaded documents count against CacheBudget and the least recently
+// prefetched go first when it runs short.
+class DocumentPrefetcher : public QObject, public CacheBudget::Client {
+  Q_OBJECT
+ public:
+  explicit DocumentPrefetcher(QObject* parent = nullptr);
+  ~DocumentPrefetcher() override;
+
+  // Starts loading each path that isn't already loaded or in flight. A
+  // loaded copy whose file changed since is loaded again.
+  void prefetch(const QStringList& paths);
+
+  // Hands over the prefetched document for `path` (absolute), reparented to
+  // `parent`, waiting for it if it's still loading. nullptr if it wasn't
+  // prefetched, failed to load or the file changed since; load it normally.
+  Document* take(const QString& path, QObject* parent);
+
+  const char* cacheName() const override { return "prefetched documents"; }
+  qint64 cacheBytes() const override;
+  quint64 oldestUse() const override;
+  void evictOldest() override;
+
+ signals:
+  void prefetched(const QString& path);
+
+ private:
+  struct Entry {
+    QDateTime modified;  // file time when the load started
+    QFutureWatcher<Document*>* watcher = nullptr;  // while loading
+    Document* doc = nullptr;
+    qint64 bytes = 0;
+    quint64 lastUse = 0;
+  };
+
+  void finishLoad(const QString& path, QFutureWatcher<Document*>* watcher);
+  void drop(const QString& path);
+
+  QHash<QString, Entry> entries_;
+};
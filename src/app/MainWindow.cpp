@@ -10,13 +10,31 @@
 #include <QPushButton>
 #include <QFrame>
 #include <QInputDialog>
-
-#include "canvas/CanvasWidget.h"
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFontDatabase>
+#include <QPlainTextEdit>
+#include <QVBoxLayout>
+#include <QSettings>
+#include <QTabBar>
+#include <QTabWidget>
+
+#include "app/DocumentPrefetcher.h"
 #include "model/Document.h"
 #include "storage/SqliteStore.h"
 #include "export/PdfExporter.h"
+#include "export/SvgExporter.h"
 #include <QGraphicsDropShadowEffect>
 
+#include <algorithm>
+
+namespace
+{
+constexpr int kMaxRecentFiles = 8;
+// Only the newest few are kept loaded in the background.
+constexpr int kPrefetchedFiles = 4;
+}
+
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 {
   setWindowIcon(QIcon(":/assets/vellum-icon.png"));
@@ -85,12 +103,18 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
   setStyleSheet(goodnotesStyle);
   setWindowTitle("Vellum");
 
-  // Core model and view setup
-  doc_ = new Document(this);
-  canvas_ = new CanvasWidget(this);
-  canvas_->setObjectName("CanvasContainer");
-  canvas_->setDocument(doc_);
-  setCentralWidget(canvas_);
+  // Core model and view setup: a tab per open document, each with its own
+  // canvas and undo stack.
+  tabWidget_ = new QTabWidget(this);
+  tabWidget_->setDocumentMode(true);
+  tabWidget_->setTabsClosable(true);
+  tabWidget_->setMovable(true);
+  setCentralWidget(tabWidget_);
+  connect(tabWidget_, &QTabWidget::currentChanged, this, &MainWindow::activateTab);
+  connect(tabWidget_, &QTabWidget::tabCloseRequested, this, &MainWindow::closeTab);
+
+  prefetcher_ = new DocumentPrefetcher(this);
+  addTab(new Document(this), QString());
 
   // --- 2. DOCUMENT BAR (Top Blue Bar) ---
   auto *docBar = new QToolBar(this);
@@ -100,6 +124,15 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 
   actNew_ = docBar->addAction(QIcon::fromTheme("document-new"), "New", this, &MainWindow::newDocument);
   actOpen_ = docBar->addAction(QIcon::fromTheme("document-open"), "Open", this, &MainWindow::openDocument);
+
+  auto *recentBtn = new QToolButton(docBar);
+  recentBtn->setIcon(QIcon::fromTheme("document-open-recent"));
+  recentBtn->setToolTip("Open Recent");
+  recentBtn->setPopupMode(QToolButton::InstantPopup);
+  recentMenu_ = new QMenu(recentBtn);
+  connect(recentMenu_, &QMenu::aboutToShow, this, &MainWindow::rebuildRecentMenu);
+  recentBtn->setMenu(recentMenu_);
+  docBar->addWidget(recentBtn);
   actSave_ = docBar->addAction(QIcon::fromTheme("document-save"), "Save", this, &MainWindow::saveDocument);
 
   // Replace the empty spacer with a clickable title button
@@ -120,8 +153,27 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
   actToggleGrid_->setCheckable(true); // Makes it look "pressed" when active
 
   connect(actToggleGrid_, &QAction::toggled, this, [this](bool checked)
-          { canvas_->setPageType(checked ? CanvasWidget::PageType::Grid
-                                         : CanvasWidget::PageType::Plain); });
+          {
+            pageType_ = checked ? CanvasWidget::PageType::Grid : CanvasWidget::PageType::Plain;
+            canvas_->setPageType(pageType_); });
+
+  // Debug: document content and memory statistics (not on the toolbar).
+  auto *actStats = new QAction("Document Statistics", this);
+  actStats->setShortcut(QKeySequence("Ctrl+Shift+I"));
+  connect(actStats, &QAction::triggered, this, &MainWindow::showDocumentStats);
+  addAction(actStats);
+
+  // Through Document so the canvas can push pending text edits first.
+  auto *actUndo = new QAction("Undo", this);
+  actUndo->setShortcut(QKeySequence::Undo);
+  connect(actUndo, &QAction::triggered, this, [this]()
+          { doc_->undo(); });
+  addAction(actUndo);
+  auto *actRedo = new QAction("Redo", this);
+  actRedo->setShortcut(QKeySequence::Redo);
+  connect(actRedo, &QAction::triggered, this, [this]()
+          { doc_->redo(); });
+  addAction(actRedo);
   // --- 3. FLOATING TOOLBAR SETUP (The iPad Pill) ---
   floatingToolbar_ = new QWidget(this);
 
@@ -177,7 +229,9 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 
     connect(btn, &QToolButton::toggled, this, [this, t](bool on)
             {
-            if (on) canvas_->setTool(t.type); });
+            if (!on) return;
+            tool_ = t.type;
+            canvas_->setTool(t.type); });
   }
 
   pillLayout->addSpacing(5);
@@ -220,6 +274,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 
     connect(cBtn, &QToolButton::clicked, this, [this, c, colorMenu]()
             {
+              penColor_ = c;
               canvas_->setPenColor(c);
               colorMenu->close(); // Close the menu after selection
             });
@@ -279,9 +334,10 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 
   connect(fontPicker, &QComboBox::currentTextChanged, this, [this](const QString &text)
           {
-    if (text == "Sans Serif") canvas_->updateFontFamily("Arial");
-    else if (text == "Serif") canvas_->updateFontFamily("Times New Roman");
-    else canvas_->updateFontFamily("Courier New"); });
+    if (text == "Sans Serif") fontFamily_ = "Arial";
+    else if (text == "Serif") fontFamily_ = "Times New Roman";
+    else fontFamily_ = "Courier New";
+    canvas_->updateFontFamily(fontFamily_); });
   textLayout->addWidget(fontPicker);
 
   // B. Vertical Line
@@ -300,7 +356,9 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
   textLayout->addWidget(sizeSpin);
 
   connect(sizeSpin, &QSpinBox::valueChanged, this, [this](int s)
-          { canvas_->updateFontSize(s); });
+          {
+            fontSize_ = s;
+            canvas_->updateFontSize(s); });
 
   auto *textAction = new QWidgetAction(textMenu);
   textAction->setDefaultWidget(textContainer);
@@ -311,6 +369,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
   floatingToolbar_->raise();
   updateWindowTitle();
   resize(1100, 800);
+
+  prefetchRecentFiles();
 }
 
 // Ensure the floating bar stays centered when window resizes
@@ -320,13 +380,175 @@ void MainWindow::resizeEvent(QResizeEvent *event)
   if (floatingToolbar_)
   {
     int x = (width() - floatingToolbar_->width()) / 2;
-    floatingToolbar_->move(x, 70); // 70px down to clear the blue bar
+    // Clear the blue bar and the tab bar below it.
+    floatingToolbar_->move(x, 70 + tabWidget_->tabBar()->sizeHint().height());
   }
 }
 void MainWindow::newDocument()
 {
-  doc_->clear();
-  setCurrentPath(QString());
+  addTab(new Document(this), QString());
+}
+
+void MainWindow::addTab(Document *doc, const QString &path)
+{
+  auto *canvas = new CanvasWidget(tabWidget_);
+  canvas->setObjectName("CanvasContainer");
+  canvas->setDocument(doc);
+  openTabs_.push_back({canvas, doc, path});
+  connect(doc->undoStack(), &QUndoStack::cleanChanged, this, [this, canvas]()
+          {
+            if (Tab *tab = tabFor(canvas)) updateTabTitle(*tab); });
+
+  const int index = tabWidget_->addTab(canvas, QString());
+  updateTabTitle(openTabs_.back());
+  tabWidget_->setCurrentIndex(index);
+}
+
+bool MainWindow::closeTab(int index)
+{
+  Tab *tab = tabFor(tabWidget_->widget(index));
+  if (!tab)
+    return false;
+
+  if (!tab->doc->undoStack()->isClean())
+  {
+    tabWidget_->setCurrentIndex(index);
+    const QString name = tab->path.isEmpty() ? "Untitled" : QFileInfo(tab->path).fileName();
+    const auto choice = QMessageBox::question(this, "Close Document", QString("Save changes to %1?").arg(name),
+                                              QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel,
+                                              QMessageBox::Save);
+    if (choice == QMessageBox::Cancel || (choice == QMessageBox::Save && !saveDocument()))
+      return false;
+    tab = tabFor(tabWidget_->widget(index));
+  }
+
+  CanvasWidget *canvas = tab->canvas;
+  Document *doc = tab->doc;
+  const QString path = tab->path;
+  openTabs_.removeAt(tab - openTabs_.data());
+
+  // The toolbars always act on some canvas, so keep one tab open.
+  if (tabWidget_->count() == 1)
+    addTab(new Document(this), QString());
+  tabWidget_->removeTab(tabWidget_->indexOf(canvas));
+  delete canvas;
+  delete doc;
+
+  // Reopening it should be as quick as switching to it was.
+  if (!path.isEmpty())
+    prefetchRecentFiles();
+  return true;
+}
+
+void MainWindow::activateTab(int index)
+{
+  Tab *tab = tabFor(tabWidget_->widget(index));
+  if (!tab)
+    return;
+  canvas_ = tab->canvas;
+  doc_ = tab->doc;
+  currentPath_ = tab->path;
+  applyCanvasSettings(canvas_);
+  canvas_->setFocus();
+  updateWindowTitle();
+}
+
+MainWindow::Tab *MainWindow::tabFor(const QWidget *canvas)
+{
+  for (Tab &tab : openTabs_)
+  {
+    if (tab.canvas == canvas)
+      return &tab;
+  }
+  return nullptr;
+}
+
+bool MainWindow::isOpen(const QString &path) const
+{
+  return std::any_of(openTabs_.begin(), openTabs_.end(), [&](const Tab &tab)
+                     { return tab.path == path; });
+}
+
+void MainWindow::updateTabTitle(const Tab &tab)
+{
+  const int index = tabWidget_->indexOf(tab.canvas);
+  if (index < 0)
+    return;
+  const QString name = tab.path.isEmpty() ? "Untitled" : QFileInfo(tab.path).fileName();
+  tabWidget_->setTabText(index, tab.doc->undoStack()->isClean() ? name : name + " *");
+  tabWidget_->setTabToolTip(index, tab.path);
+  tabWidget_->setTabIcon(index, tab.path.isEmpty() ? QIcon() : thumbnailIcon(tab.path));
+}
+
+void MainWindow::applyCanvasSettings(CanvasWidget *canvas) const
+{
+  if (canvas->tool() != tool_)
+    canvas->setTool(tool_);
+  canvas->setPageType(pageType_);
+  if (penColor_.isValid())
+    canvas->setPenColor(penColor_);
+  if (!fontFamily_.isEmpty())
+    canvas->updateFontFamily(fontFamily_);
+  if (fontSize_ > 0)
+    canvas->updateFontSize(fontSize_);
+}
+
+QStringList MainWindow::recentFiles() const
+{
+  return QSettings().value("recentFiles").toStringList();
+}
+
+void MainWindow::noteRecentFile(const QString &path)
+{
+  QStringList files = recentFiles();
+  files.removeAll(path);
+  files.prepend(path);
+  while (files.size() > kMaxRecentFiles)
+    files.removeLast();
+  QSettings().setValue("recentFiles", files);
+  prefetchRecentFiles();
+}
+
+void MainWindow::prefetchRecentFiles()
+{
+  QStringList paths;
+  for (const QString &path : recentFiles())
+  {
+    if (paths.size() == kPrefetchedFiles)
+      break;
+    if (!isOpen(path))
+      paths.push_back(path);
+  }
+  prefetcher_->prefetch(paths);
+}
+
+void MainWindow::rebuildRecentMenu()
+{
+  recentMenu_->clear();
+  for (const QString &path : recentFiles())
+  {
+    if (!QFileInfo::exists(path))
+      continue;
+    recentMenu_->addAction(thumbnailIcon(path), QFileInfo(path).fileName(), this, [this, path]()
+                           { openPath(path); });
+  }
+  if (recentMenu_->isEmpty())
+    recentMenu_->addAction("No recent documents")->setEnabled(false);
+}
+
+QIcon MainWindow::thumbnailIcon(const QString &path)
+{
+  const QDateTime modified = QFileInfo(path).lastModified();
+  if (Thumbnail *t = thumbnails_.find(path))
+  {
+    if (t->modified == modified)
+      return t->icon;
+  }
+  // Reads one small row, but the menu and tab bar ask on every rebuild.
+  const QImage image = SqliteStore::readThumbnail(path);
+  const QIcon icon = image.isNull() ? QIcon() : QIcon(QPixmap::fromImage(image));
+  thumbnails_.insert(path, Thumbnail{modified, icon}, qint64(image.sizeInBytes()) + 256);
+  return icon;
 }
 
 void MainWindow::createColorPalette(QToolBar *targetBar) // Use the pointer we passed in
@@ -354,7 +576,9 @@ void MainWindow::createColorPalette(QToolBar *targetBar) // Use the pointer we p
     // Add action directly to targetBar (DrawingToolbar)
     QAction *action = targetBar->addAction(QIcon(pix), "");
     connect(action, &QAction::triggered, [this, color]()
-            { canvas_->setPenColor(color); });
+            {
+              penColor_ = color;
+              canvas_->setPenColor(color); });
   }
 
   targetBar->addSeparator();
@@ -363,7 +587,9 @@ void MainWindow::createColorPalette(QToolBar *targetBar) // Use the pointer we p
   connect(customColor, &QAction::triggered, [this]()
           {
         QColor c = QColorDialog::getColor(Qt::black, this);
-        if (c.isValid()) canvas_->setPenColor(c); });
+        if (!c.isValid()) return;
+        penColor_ = c;
+        canvas_->setPenColor(c); });
 }
 void MainWindow::setupTextToolbar()
 {
@@ -384,11 +610,15 @@ void MainWindow::setupTextToolbar()
 
   // When the font family changes
   connect(fontCombo, &QFontComboBox::currentFontChanged, this, [this](const QFont &f)
-          { canvas_->updateFontFamily(f.family()); });
+          {
+            fontFamily_ = f.family();
+            canvas_->updateFontFamily(fontFamily_); });
 
   // When the font size changes
   connect(sizeSpin, &QSpinBox::valueChanged, this, [this](int s)
-          { canvas_->updateFontSize(s); });
+          {
+            fontSize_ = s;
+            canvas_->updateFontSize(s); });
 }
 
 void MainWindow::openDocument()
@@ -397,15 +627,47 @@ void MainWindow::openDocument()
                                                     "Vellum Notes (*.vellum);;All Files (*)");
   if (path.isEmpty())
     return;
+  openPath(path);
+}
 
-  QString err;
-  if (!SqliteStore::loadFromFile(path, doc_, &err))
+bool MainWindow::openPath(const QString &path)
+{
+  const QString absPath = QFileInfo(path).absoluteFilePath();
+  for (const Tab &tab : openTabs_)
   {
-    QMessageBox::critical(this, "Open failed", err);
-    return;
+    if (tab.path == absPath)
+    {
+      tabWidget_->setCurrentWidget(tab.canvas);
+      return true;
+    }
+  }
+
+  // Recent documents are usually loaded in the background already.
+  Document *doc = prefetcher_->take(absPath, this);
+  if (!doc)
+  {
+    doc = new Document(this);
+    QString err;
+    if (!SqliteStore::loadFromFile(absPath, doc, &err))
+    {
+      delete doc;
+      QMessageBox::critical(this, "Open failed", err);
+      return false;
+    }
   }
 
-  setCurrentPath(path);
+  // An untouched Untitled tab is replaced instead of left behind.
+  const Tab *current = tabFor(canvas_);
+  QWidget *replaced = nullptr;
+  if (current && current->path.isEmpty() && current->doc->strokes().isEmpty() &&
+      current->doc->textBoxes().isEmpty() && current->doc->undoStack()->count() == 0)
+    replaced = current->canvas;
+
+  addTab(doc, absPath);
+  if (replaced)
+    closeTab(tabWidget_->indexOf(replaced));
+  noteRecentFile(absPath);
+  return true;
 }
 
 bool MainWindow::saveDocument()
@@ -419,6 +681,9 @@ bool MainWindow::saveDocument()
     QMessageBox::critical(this, "Save failed", err);
     return false;
   }
+  doc_->undoStack()->setClean();
+  if (Tab *tab = tabFor(canvas_))
+    updateTabTitle(*tab);
   updateWindowTitle();
   return true;
 }
@@ -474,16 +739,33 @@ bool MainWindow::saveDocumentAs()
     QMessageBox::critical(this, "Save failed", err);
     return false;
   }
-  setCurrentPath(finalPath);
+  doc_->undoStack()->setClean();
+  setCurrentPath(QFileInfo(finalPath).absoluteFilePath());
+  noteRecentFile(currentPath_);
   return true;
 }
 
 void MainWindow::exportPdf()
 {
-  const QString path = QFileDialog::getSaveFileName(this, "Export PDF", QString(),
-                                                    "PDF (*.pdf);;All Files (*)");
+  QString selectedFilter;
+  const QString path = QFileDialog::getSaveFileName(this, "Export", QString(),
+                                                    "PDF (*.pdf);;SVG (*.svg);;All Files (*)", &selectedFilter);
   if (path.isEmpty())
     return;
+
+  QString err;
+  if (path.endsWith(".svg") || selectedFilter.startsWith("SVG"))
+  {
+    QString finalPath = path;
+    if (!finalPath.endsWith(".svg"))
+      finalPath += ".svg";
+
+    // SVG always contains the whole canvas.
+    if (!SvgExporter::exportToSvg(finalPath, *doc_, &err))
+      QMessageBox::critical(this, "Export failed", err);
+    return;
+  }
+
   QString finalPath = path;
   if (!finalPath.endsWith(".pdf"))
     finalPath += ".pdf";
@@ -492,7 +774,6 @@ void MainWindow::exportPdf()
   // For now we approximate viewport as what the canvas currently shows in world coords.
   const QRectF viewportWorld = canvas_->currentViewportWorld();
 
-  QString err;
   if (!PdfExporter::exportToPdf(finalPath, *doc_, viewportWorld, &err))
   {
     QMessageBox::critical(this, "Export failed", err);
@@ -500,9 +781,37 @@ void MainWindow::exportPdf()
   }
 }
 
+void MainWindow::showDocumentStats()
+{
+  QDialog dlg(this);
+  dlg.setWindowTitle("Document Statistics");
+  auto *text = new QPlainTextEdit(&dlg);
+  text->setReadOnly(true);
+  text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+  text->setMinimumSize(420, 300);
+  auto refresh = [this, text]()
+  { text->setPlainText(doc_->stats().describe() + "\nShared caches\n" + CacheBudget::describe()); };
+  refresh();
+
+  auto *buttons = new QDialogButtonBox(QDialogButtonBox::Close, &dlg);
+  QPushButton *refreshBtn = buttons->addButton("Refresh", QDialogButtonBox::ActionRole);
+  connect(refreshBtn, &QPushButton::clicked, &dlg, refresh);
+  connect(buttons, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+
+  auto *layout = new QVBoxLayout(&dlg);
+  layout->addWidget(text);
+  layout->addWidget(buttons);
+  dlg.exec();
+}
+
 void MainWindow::setCurrentPath(const QString &path)
 {
   currentPath_ = path;
+  if (Tab *tab = tabFor(canvas_))
+  {
+    tab->path = path;
+    updateTabTitle(*tab);
+  }
   updateWindowTitle();
 }
 
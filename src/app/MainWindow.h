@@ -14,11 +14,17 @@
 #include <QComboBox>
 // #include <QPaintEvent>
 #include <QFrame>
+#include <QDateTime>
+#include <QIcon>
+#include <QVector>
 
+#include "cache/CacheBudget.h"
+#include "canvas/CanvasWidget.h"
 
 class QAction;
-class CanvasWidget;
+class QTabWidget;
 class Document;
+class DocumentPrefetcher;
 class QWidget;
 class QSpinBox;
 class QFontComboBox;
@@ -39,16 +45,56 @@ class MainWindow : public QMainWindow {
   void renameDocument();
   bool saveDocumentAs();
   void exportPdf();
+  void showDocumentStats();
   void createColorPalette(QToolBar* targetBar);
 
   void setCurrentPath(const QString& path);
   void updateWindowTitle();
 
+  // One open document: its own canvas, undo stack and file.
+  struct Tab {
+    CanvasWidget* canvas = nullptr;
+    Document* doc = nullptr;
+    QString path;
+  };
+  void addTab(Document* doc, const QString& path);
+  bool openPath(const QString& path);
+  bool closeTab(int index);
+  void activateTab(int index);
+  Tab* tabFor(const QWidget* canvas);
+  bool isOpen(const QString& path) const;
+  void updateTabTitle(const Tab& tab);
+  // Tool, color, page and font choices apply to whichever tab is current.
+  void applyCanvasSettings(CanvasWidget* canvas) const;
+
+  QStringList recentFiles() const;
+  void noteRecentFile(const QString& path);
+  void prefetchRecentFiles();
+  void rebuildRecentMenu();
+  QIcon thumbnailIcon(const QString& path);
+
+  // The current tab's.
   CanvasWidget* canvas_ = nullptr;
   Document* doc_ = nullptr;
-
   QString currentPath_;
 
+  QTabWidget* tabWidget_ = nullptr;
+  QVector<Tab> openTabs_;
+  DocumentPrefetcher* prefetcher_ = nullptr;
+  QMenu* recentMenu_ = nullptr;
+
+  struct Thumbnail {
+    QDateTime modified;
+    QIcon icon;
+  };
+  BudgetedCache<QString, Thumbnail> thumbnails_{"thumbnails"};
+
+  CanvasWidget::Tool tool_ = CanvasWidget::Tool::Pen;
+  CanvasWidget::PageType pageType_ = CanvasWidget::PageType::Plain;
+  QColor penColor_;     // invalid until picked: the canvas default
+  QString fontFamily_;  // empty until picked
+  int fontSize_ = 0;    // 0 until picked
+
   QWidget* floatingToolbar_ = nullptr;
 
   QAction* actNew_ = nullptr;
@@ -0,0 +1,192 @@
+#include "SyntheticDocuments.h"
+
+#include <QRandomGenerator>
+#include <QtMath>
+
+#include <functional>
+
+#include "canvas/CanvasWidget.h"
+#include "model/Document.h"
+
+static QColor inkColor(QRandomGenerator& rng) {
+  static const QColor kColors[] = {QColor(20, 20, 20), QColor(30, 80, 200), QColor(200, 40, 40),
+                                   QColor(20, 140, 60)};
+  return kColors[rng.bounded(4)];
+}
+
+static void addStroke(Document* doc, Stroke s) {
+  s.id = doc->nextStrokeId();
+  doc->insertStroke(-1, std::move(s));
+}
+
+void SyntheticDocuments::fillGrid(Document* doc, int strokes, int points, quint32 seed) {
+  QRandomGenerator rng(seed);
+  const int cols = std::max(1, qCeil(std::sqrt(double(strokes))));
+  for (int i = 0; i < strokes; ++i) {
+    Stroke s;
+    s.color = inkColor(rng);
+    s.baseWidthPoints = 1.0 + rng.bounded(3.0);
+    s.pts.reserve(points);
+    QPointF p((i % cols) * 60.0, (i / cols) * 60.0);
+    double heading = rng.bounded(2 * M_PI);
+    for (int j = 0; j < points; ++j) {
+      heading += rng.bounded(0.6) - 0.3;
+      p += QPointF(std::cos(heading), std::sin(heading)) * 0.8;
+      s.pts.append(p, 0.4f + 0.6f * float(rng.generateDouble()), qint64(j) * 5);
+    }
+    addStroke(doc, std::move(s));
+  }
+}
+
+void SyntheticDocuments::fillHandwriting(Document* doc, int lines, int wordsPerLine, quint32 seed) {
+  QRandomGenerator rng(seed);
+  constexpr double kLineHeight = 32.0;
+  constexpr double kLetterWidth = 9.0;
+  qint64 t = 0;
+  for (int line = 0; line < lines; ++line) {
+    double x = 40.0;
+    const double baseline = 60.0 + line * kLineHeight;
+    for (int w = 0; w < wordsPerLine; ++w) {
+      Stroke s;
+      s.color = QColor(20, 20, 20);
+      s.baseWidthPoints = 1.6;
+      const int letters = 2 + rng.bounded(7);
+      const int kind = rng.bounded(40);
+      if (kind == 0) {
+        // Underline.
+        for (int j = 0; j <= 40; ++j) s.pts.append(QPointF(x + j * letters * kLetterWidth / 40.0, baseline + 4), 0.8f, t += 6);
+      } else if (kind == 1) {
+        // Hand-drawn circle.
+        const QPointF c(x + 12, baseline - 10);
+        for (int j = 0; j <= 60; ++j) {
+          const double a = j * 2 * M_PI / 60.0;
+          const double r = 11.0 + rng.bounded(1.0);
+          s.pts.append(c + QPointF(std::cos(a), std::sin(a)) * r, 0.8f, t += 6);
+        }
+      } else {
+        // Cursive loops: one per letter, with wobble and pressure changes.
+        const int perLetter = 14;
+        for (int j = 0; j < letters * perLetter; ++j) {
+          const double u = double(j) / perLetter;
+          const double a = u * 2 * M_PI;
+          const double height = 6.0 + 4.0 * std::sin(u * 1.7);
+          const QPointF p(x + u * kLetterWidth + 3.0 * std::sin(a) + rng.bounded(0.4),
+                          baseline - height * (0.5 - 0.5 * std::cos(a)) + rng.bounded(0.4));
+          s.pts.append(p, float(0.5 + 0.4 * std::sin(u)), t += 7);
+        }
+      }
+      x += letters * kLetterWidth + 10.0;
+      t += 120;
+      addStroke(doc, std::move(s));
+    }
+  }
+}
+
+void SyntheticDocuments::fillSpread(Document* doc, int strokes, int points, double extent, quint32 seed) {
+  QRandomGenerator rng(seed);
+  for (int i = 0; i < strokes; ++i) {
+    Stroke s;
+    s.color = inkColor(rng);
+    s.baseWidthPoints = 2.0;
+    s.pts.reserve(points);
+    QPointF p(rng.bounded(extent) - extent / 2, rng.bounded(extent) - extent / 2);
+    double heading = rng.bounded(2 * M_PI);
+    for (int j = 0; j < points; ++j) {
+      heading += rng.bounded(0.4) - 0.2;
+      p += QPointF(std::cos(heading), std::sin(heading)) * 1.5;
+      s.pts.append(p, 1.0f, qint64(j) * 5);
+    }
+    addStroke(doc, std::move(s));
+  }
+}
+
+qint64 SyntheticDocuments::pointCount(const Document& doc) {
+  qint64 n = 0;
+  for (const auto& s : doc.strokes()) n += s.pts.size();
+  return n;
+}
+
+InputRecording SyntheticDocuments::penSession(const QSize& view, int strokes, quint32 seed) {
+  QRandomGenerator rng(seed);
+  constexpr qint64 kSampleMs = 4;  // 240 Hz tablet
+  InputRecording rec;
+  rec.viewSize = view;
+  qint64 t = 0;
+
+  auto add = [&](InputSample::Kind kind, const QPointF& pos, float pressure = 1.0f) {
+    InputSample s;
+    s.kind = kind;
+    s.tMs = t;
+    s.pos = pos;
+    s.pressure = pressure;
+    const bool down = kind != InputSample::Kind::MouseRelease && kind != InputSample::Kind::TabletRelease;
+    s.button = kind == InputSample::Kind::MouseMove || kind == InputSample::Kind::TabletMove ? Qt::NoButton
+                                                                                             : Qt::LeftButton;
+    s.buttons = down ? Qt::LeftButton : Qt::NoButton;
+    rec.samples.push_back(s);
+  };
+  auto setTool = [&](CanvasWidget::Tool tool) {
+    InputSample s;
+    s.kind = InputSample::Kind::SetTool;
+    s.tMs = t;
+    s.tool = static_cast<int>(tool);
+    rec.samples.push_back(s);
+  };
+  // One tablet stroke through `path(u)`, u in [0, 1].
+  auto penStroke = [&](int samples, const std::function<QPointF(double)>& path) {
+    for (int j = 0; j < samples; ++j) {
+      const double u = double(j) / (samples - 1);
+      const float pressure = float(0.35 + 0.5 * std::sin(u * M_PI));
+      add(j == 0 ? InputSample::Kind::TabletPress : InputSample::Kind::TabletMove, path(u), pressure);
+      t += kSampleMs;
+    }
+    add(InputSample::Kind::TabletRelease, path(1.0), 0.0f);
+    t += 150 + rng.bounded(200);
+  };
+
+  setTool(CanvasWidget::Tool::Pen);
+  const double margin = 40.0;
+  const QSizeF area(std::max(1, view.width()) - 2 * margin, std::max(1, view.height()) - 2 * margin);
+  for (int i = 0; i < strokes; ++i) {
+    const QPointF o(margin + rng.bounded(area.width() * 0.8), margin + rng.bounded(area.height() * 0.9));
+    const int kind = rng.bounded(10);
+    if (kind == 0) {
+      const QPointF d(60 + rng.bounded(200.0), rng.bounded(40.0) - 20);
+      penStroke(40, [&](double u) { return o + d * u; });
+    } else if (kind == 1) {
+      const double w = 50 + rng.bounded(100.0);
+      const double h = 40 + rng.bounded(80.0);
+      penStroke(80, [&](double u) {
+        const double e = u * 2 * (w + h);  // walk the perimeter
+        if (e < w) return o + QPointF(e, 0);
+        if (e < w + h) return o + QPointF(w, e - w);
+        if (e < 2 * w + h) return o + QPointF(w - (e - w - h), h);
+        return o + QPointF(0, h - (e - 2 * w - h));
+      });
+    } else {
+      const int letters = 3 + rng.bounded(6);
+      const double wobble = rng.bounded(0.5);
+      penStroke(letters * 18, [&](double u) {
+        const double a = u * letters * 2 * M_PI;
+        return o + QPointF(u * letters * 10.0 + 3.0 * std::sin(a), -8.0 * (0.5 - 0.5 * std::cos(a)) + wobble);
+      });
+    }
+
+    if (i % 12 == 11) {
+      // Mouse eraser sweep across the area just written.
+      setTool(CanvasWidget::Tool::Eraser);
+      const QPointF from(margin, o.y());
+      const QPointF to(margin + area.width(), o.y() + rng.bounded(40.0) - 20);
+      constexpr int kMoves = 60;
+      for (int j = 0; j <= kMoves; ++j) {
+        add(j == 0 ? InputSample::Kind::MousePress : InputSample::Kind::MouseMove,
+            from + (to - from) * (double(j) / kMoves));
+        t += 8;
+      }
+      add(InputSample::Kind::MouseRelease, to);
+      t += 200;
+      setTool(CanvasWidget::Tool::Pen);
+    }
+  }
+  return rec;
+}
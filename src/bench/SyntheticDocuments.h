@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QSize>
+#include <QtGlobal>
+
+#include "canvas/InputRecorder.h"
+
+class Document;
+
+// Deterministic documents for benchmarks. Each generator appends to `doc`
+// and uses `seed` for all randomness, so runs compare like for like.
+class SyntheticDocuments {
+ public:
+  // `strokes` random-walk strokes of `points` samples each, laid out on a
+  // grid starting at the origin.
+  static void fillGrid(Document* doc, int strokes, int points, quint32 seed = 1);
+
+  // Rows of cursive-like words: short looping strokes packed tightly, with
+  // varying pressure and some recognizable shapes (lines, boxes, circles)
+  // mixed in.
+  static void fillHandwriting(Document* doc, int lines, int wordsPerLine, quint32 seed = 2);
+
+  // Strokes scattered over a square `extent` world units wide centered on
+  // the origin, like a large infinite-canvas board.
+  static void fillSpread(Document* doc, int strokes, int points, double extent, quint32 seed = 3);
+
+  // A pen session on a `view`-sized canvas: `strokes` tablet strokes of
+  // handwriting sampled at 240 Hz, some straight lines and boxes for the
+  // recognizer, and an eraser pass every 12 strokes.
+  static InputRecording penSession(const QSize& view, int strokes, quint32 seed = 4);
+
+  // Total samples over all strokes.
+  static qint64 pointCount(const Document& doc);
+};
@@ -0,0 +1,283 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMouseEvent>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "bench/SyntheticDocuments.h"
+#include "canvas/CanvasWidget.h"
+#include "canvas/InputReplayer.h"
+#include "export/PdfExporter.h"
+#include "model/Document.h"
+#include "shapes/ShapeRecognizer.h"
+#include "storage/SqliteStore.h"
+
+namespace {
+
+struct Fixture {
+  QString name;
+  std::unique_ptr<Document> doc;
+};
+
+class Bench {
+ public:
+  explicit Bench(int iterations) : iterations_(std::max(1, iterations)) {}
+
+  // Times `body` `iterations_` times; `setup` runs untimed before each one.
+  void run(const QString& name, const Fixture& fx, qint64 items, const std::function<void()>& body,
+           const std::function<void()>& setup = {}) {
+    QVector<double> ms;
+    ms.reserve(iterations_);
+    for (int i = 0; i < iterations_; ++i) {
+      if (setup) setup();
+      QElapsedTimer t;
+      t.start();
+      body();
+      ms.push_back(t.nsecsElapsed() / 1e6);
+    }
+    std::sort(ms.begin(), ms.end());
+    double sum = 0;
+    for (double v : ms) sum += v;
+
+    QJsonObject r;
+    r["name"] = name;
+    r["document"] = fx.name;
+    r["strokes"] = qint64(fx.doc->strokes().size());
+    r["points"] = SyntheticDocuments::pointCount(*fx.doc);
+    r["items"] = items;
+    r["iterations"] = iterations_;
+    r["min_ms"] = ms.front();
+    r["median_ms"] = ms[ms.size() / 2];
+    r["mean_ms"] = sum / ms.size();
+    r["max_ms"] = ms.back();
+    results_.append(r);
+
+    QTextStream(stderr) << name << " [" << fx.name << "]  median " << ms[ms.size() / 2] << " ms" << Qt::endl;
+  }
+
+  // Adds fields to the most recent result.
+  void annotate(const QJsonObject& extra) {
+    if (results_.isEmpty()) return;
+    QJsonObject r = results_.last().toObject();
+    for (auto it = extra.begin(); it != extra.end(); ++it) r[it.key()] = it.value();
+    results_[results_.size() - 1] = r;
+  }
+
+  QJsonArray results() const { return results_; }
+
+ private:
+  int iterations_;
+  QJsonArray results_;
+};
+
+void sendMouse(QWidget* w, QEvent::Type type, const QPointF& pos, Qt::MouseButtons buttons) {
+  QMouseEvent e(type, pos, w->mapToGlobal(pos), Qt::LeftButton, buttons, Qt::NoModifier);
+  QApplication::sendEvent(w, &e);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // Paint and export are measured offscreen, independent of any display.
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QApplication app(argc, argv);
+  QApplication::setApplicationName("vellum_bench");
+  QApplication::setOrganizationName("Vellum");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Benchmarks storage, recognition, erasing, painting and export on synthetic documents.");
+  parser.addHelpOption();
+  QCommandLineOption outOpt({"o", "output"}, "Write JSON results to <file> instead of stdout.", "file");
+  QCommandLineOption iterOpt({"n", "iterations"}, "Timed runs per benchmark.", "n", "5");
+  QCommandLineOption scaleOpt("scale", "Multiplier for synthetic document sizes.", "factor", "1");
+  QCommandLineOption filterOpt("filter", "Only run benchmarks whose name contains <text>.", "text");
+  QCommandLineOption replayOpt("replay", "Replay this input recording (F4 in the app) instead of a synthetic session.",
+                               "file");
+  QCommandLineOption replaySpeedOpt("replay-speed", "Input replay speed; 1 is real time, 0 as fast as possible.",
+                                    "factor", "0");
+  parser.addOption(outOpt);
+  parser.addOption(iterOpt);
+  parser.addOption(scaleOpt);
+  parser.addOption(filterOpt);
+  parser.addOption(replayOpt);
+  parser.addOption(replaySpeedOpt);
+  parser.process(app);
+
+  const double scale = std::max(0.01, parser.value(scaleOpt).toDouble());
+  const QString filter = parser.value(filterOpt);
+  auto enabled = [&](const QString& name) { return filter.isEmpty() || name.contains(filter); };
+  auto scaled = [&](int n) { return std::max(1, qRound(n * scale)); };
+
+  std::vector<Fixture> fixtures;
+  fixtures.push_back({"grid", std::make_unique<Document>()});
+  SyntheticDocuments::fillGrid(fixtures.back().doc.get(), scaled(2000), 200);
+  fixtures.push_back({"handwriting", std::make_unique<Document>()});
+  SyntheticDocuments::fillHandwriting(fixtures.back().doc.get(), scaled(80), 12);
+  fixtures.push_back({"spread", std::make_unique<Document>()});
+  SyntheticDocuments::fillSpread(fixtures.back().doc.get(), scaled(20000), 60, 2.0e6);
+  for (auto& fx : fixtures) fx.doc->compactPoints();
+
+  InputRecording session = SyntheticDocuments::penSession(QSize(1600, 1000), scaled(120));
+  if (parser.isSet(replayOpt)) {
+    QString err;
+    if (!InputRecorder::load(parser.value(replayOpt), &session, &err)) {
+      QTextStream(stderr) << "Cannot read " << parser.value(replayOpt) << ": " << err << Qt::endl;
+      return 1;
+    }
+  }
+  InputReplayOptions replayOpts;
+  replayOpts.speed = std::max(0.0, parser.value(replaySpeedOpt).toDouble());
+
+  QTemporaryDir tmp;
+  if (!tmp.isValid()) {
+    QTextStream(stderr) << "Cannot create a temporary directory" << Qt::endl;
+    return 1;
+  }
+
+  Bench bench(parser.value(iterOpt).toInt());
+  bool ok = true;
+  for (const auto& fx : fixtures) {
+    Document& doc = *fx.doc;
+    const QString file = tmp.filePath(fx.name + ".vellum");
+
+    if (enabled("sqlite_save")) {
+      bench.run("sqlite_save", fx, doc.strokes().size(), [&] {
+        QFile::remove(file);
+        QString err;
+        if (!SqliteStore::saveToFile(file, doc, &err)) {
+          QTextStream(stderr) << "save failed: " << err << Qt::endl;
+          ok = false;
+        }
+      });
+    }
+
+    if (enabled("sqlite_load")) {
+      if (!QFile::exists(file)) SqliteStore::saveToFile(file, doc, nullptr);
+      bench.run("sqlite_load", fx, doc.strokes().size(), [&] {
+        Document loaded;
+        QString err;
+        if (!SqliteStore::loadFromFile(file, &loaded, &err)) {
+          QTextStream(stderr) << "load failed: " << err << Qt::endl;
+          ok = false;
+        }
+      });
+    }
+
+    if (enabled("read_thumbnail")) {
+      if (!QFile::exists(file)) SqliteStore::saveToFile(file, doc, nullptr);
+      bench.run("read_thumbnail", fx, 1, [&] {
+        QString err;
+        if (SqliteStore::readThumbnail(file, 0, &err).isNull()) {
+          QTextStream(stderr) << "thumbnail read failed: " << err << Qt::endl;
+          ok = false;
+        }
+      });
+    }
+
+    if (enabled("shape_recognize")) {
+      double sink = 0;
+      bench.run("shape_recognize", fx, doc.strokes().size(), [&] {
+        for (const auto& s : doc.strokes()) sink += ShapeRecognizer::recognize(s).score;
+      });
+      if (sink < 0) QTextStream(stderr) << sink;
+    }
+
+    // The canvas is driven through its public surface: paint via render(),
+    // erasing via mouse events with the eraser tool.
+    CanvasWidget canvas;
+    canvas.resize(1600, 1000);
+    canvas.setDocument(&doc);
+
+    if (enabled("canvas_paint")) {
+      QImage frame(canvas.size(), QImage::Format_ARGB32_Premultiplied);
+      bench.run("canvas_paint", fx, 1, [&] { canvas.render(&frame); });
+    }
+
+    if (enabled("erase_at")) {
+      constexpr int kErases = 200;
+      QRandomGenerator rng(7);
+      canvas.setTool(CanvasWidget::Tool::Eraser);
+      int erased = 0;
+      // Hits are undone between runs so every run sees the same document.
+      auto restore = [&] {
+        for (; erased > 0; --erased) doc.undoStack()->undo();
+      };
+      bench.run("erase_at", fx, kErases, [&] {
+        for (int i = 0; i < kErases; ++i) {
+          const QPointF pos(rng.bounded(1600.0), rng.bounded(1000.0));
+          const qsizetype before = doc.strokes().size();
+          sendMouse(&canvas, QEvent::MouseButtonPress, pos, Qt::LeftButton);
+          sendMouse(&canvas, QEvent::MouseButtonRelease, pos, Qt::NoButton);
+          if (doc.strokes().size() != before) ++erased;
+        }
+      }, restore);
+      restore();
+      canvas.setTool(CanvasWidget::Tool::Pen);
+    }
+
+    // Drawing, erasing and recognition end to end: the session is replayed
+    // into a shown (offscreen) canvas and undone between runs.
+    if (enabled("input_replay")) {
+      CanvasWidget live;
+      live.setDocument(&doc);
+      live.show();
+      const int undoBase = doc.undoStack()->index();
+      InputReplayResult last;
+      bench.run(
+          "input_replay", fx, session.samples.size(),
+          [&] { last = InputReplayer::replay(&live, session, replayOpts); },
+          [&] { doc.undoStack()->setIndex(undoBase); });
+      doc.undoStack()->setIndex(undoBase);
+      bench.annotate(QJsonObject{{"replay_speed", replayOpts.speed},
+                                 {"ink_frames", last.frames},
+                                 {"latency_p50_ms", last.latencyP50Ms},
+                                 {"latency_p95_ms", last.latencyP95Ms},
+                                 {"latency_max_ms", last.latencyMaxMs}});
+    }
+
+    if (enabled("pdf_export")) {
+      const QString pdf = tmp.filePath(fx.name + ".pdf");
+      bench.run("pdf_export", fx, 1, [&] {
+        QString err;
+        if (!PdfExporter::exportToPdf(pdf, doc, QRectF(), &err)) {
+          QTextStream(stderr) << "pdf export failed: " << err << Qt::endl;
+          ok = false;
+        }
+      });
+    }
+  }
+
+  QJsonObject root;
+  root["suite"] = "vellum_bench";
+  root["qt_version"] = qVersion();
+  root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+  root["scale"] = scale;
+  root["results"] = bench.results();
+  const QByteArray json = QJsonDocument(root).toJson();
+
+  const QString outPath = parser.value(outOpt);
+  if (outPath.isEmpty()) {
+    QTextStream(stdout) << json;
+  } else {
+    QFile f(outPath);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(json) != json.size()) {
+      QTextStream(stderr) << "Cannot write " << outPath << Qt::endl;
+      return 1;
+    }
+  }
+  return ok ? 0 : 2;
+}
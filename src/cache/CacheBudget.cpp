@@ -0,0 +1,73 @@
+#include "CacheBudget.h"
+
+#include <algorithm>
+
+namespace {
+
+struct State {
+  qint64 limit = 256 * 1024 * 1024;
+  quint64 clock = 0;
+  QVector<CacheBudget::Client*> clients;
+  bool enforcing = false;
+};
+
+State& state() {
+  static State s;
+  return s;
+}
+
+}  // namespace
+
+void CacheBudget::setLimit(qint64 bytes) {
+  state().limit = std::max<qint64>(0, bytes);
+  enforce();
+}
+
+qint64 CacheBudget::limit() {
+  return state().limit;
+}
+
+qint64 CacheBudget::usage() {
+  qint64 bytes = 0;
+  for (const Client* c : state().clients) bytes += c->cacheBytes();
+  return bytes;
+}
+
+void CacheBudget::registerClient(Client* c) {
+  state().clients.push_back(c);
+}
+
+void CacheBudget::unregisterClient(Client* c) {
+  state().clients.removeOne(c);
+}
+
+quint64 CacheBudget::touch() {
+  return ++state().clock;
+}
+
+void CacheBudget::enforce() {
+  State& s = state();
+  // Evicting can release objects whose destructors touch caches again.
+  if (s.enforcing) return;
+  s.enforcing = true;
+  while (usage() > s.limit) {
+    Client* victim = nullptr;
+    for (Client* c : s.clients) {
+      if (c->oldestUse() == 0) continue;
+      if (!victim || c->oldestUse() < victim->oldestUse()) victim = c;
+    }
+    if (!victim) break;
+    victim->evictOldest();
+  }
+  s.enforcing = false;
+}
+
+QString CacheBudget::describe() {
+  auto kib = [](qint64 bytes) { return QString("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1); };
+  QString out;
+  for (const Client* c : state().clients) {
+    out += QString("%1 %2\n").arg(QString(c->cacheName()) + ':', -22).arg(kib(c->cacheBytes()));
+  }
+  out += QString("%1 %2 of %3\n").arg("total:", -22).arg(kib(usage())).arg(kib(limit()));
+  return out;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <map>
+#include <utility>
+
+// One memory limit shared by every derived-data cache in the process (text
+// layouts per canvas, thumbnails, prefetched documents). Caches register as
+// clients; when the total goes over the limit the least recently used
+// entry across all of them is evicted first, so a busy tab can take memory
+// from idle ones. GUI thread only.
+class CacheBudget {
+ public:
+  class Client {
+   public:
+    virtual ~Client() = default;
+    virtual const char* cacheName() const = 0;
+    virtual qint64 cacheBytes() const = 0;
+    // Use stamp (see touch()) of the least recently used entry; 0 if empty.
+    virtual quint64 oldestUse() const = 0;
+    virtual void evictOldest() = 0;
+  };
+
+  static void setLimit(qint64 bytes);
+  static qint64 limit();
+  static qint64 usage();
+
+  static void registerClient(Client* c);
+  static void unregisterClient(Client* c);
+
+  // A fresh use stamp; later calls return larger values.
+  static quint64 touch();
+  // Evicts least recently used entries until usage() <= limit().
+  static void enforce();
+
+  // One "name: size" line per client plus the total, for debug output.
+  static QString describe();
+};
+
+// LRU cache whose entries count against CacheBudget. Pointers returned by
+// find() stay valid until the next insert() or clear().
+template <typename Key, typename T>
+class BudgetedCache : public CacheBudget::Client {
+ public:
+  explicit BudgetedCache(const char* name) : name_(name) { CacheBudget::registerClient(this); }
+  ~BudgetedCache() override { CacheBudget::unregisterClient(this); }
+  BudgetedCache(const BudgetedCache&) = delete;
+  BudgetedCache& operator=(const BudgetedCache&) = delete;
+
+  T* find(const Key& key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return nullptr;
+    byUse_.erase(it->lastUse);
+    it->lastUse = CacheBudget::touch();
+    byUse_.emplace(it->lastUse, key);
+    return &it->value;
+  }
+
+  // Replaces any entry for `key`, then brings the shared budget back
+  // under its limit (which may evict this entry if it alone is too big).
+  void insert(const Key& key, T value, qint64 bytes) {
+    remove(key);
+    Entry e{std::move(value), bytes, CacheBudget::touch()};
+    byUse_.emplace(e.lastUse, key);
+    bytes_ += bytes;
+    entries_.insert(key, std::move(e));
+    CacheBudget::enforce();
+  }
+
+  void remove(const Key& key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return;
+    byUse_.erase(it->lastUse);
+    bytes_ -= it->bytes;
+    entries_.erase(it);
+  }
+
+  void clear() {
+    entries_.clear();
+    byUse_.clear();
+    bytes_ = 0;
+  }
+
+  qsizetype size() const { return entries_.size(); }
+
+  const char* cacheName() const override { return name_; }
+  qint64 cacheBytes() const override { return bytes_; }
+  quint64 oldestUse() const override { return byUse_.empty() ? 0 : byUse_.begin()->first; }
+  void evictOldest() override {
+    if (!byUse_.empty()) remove(byUse_.begin()->second);
+  }
+
+ private:
+  struct Entry {
+    T value;
+    qint64 bytes = 0;
+    quint64 lastUse = 0;
+  };
+
+  const char* name_;
+  QHash<Key, Entry> entries_;
+  std::map<quint64, Key> byUse_;
+  qint64 bytes_ = 0;
+};
@@ -2,10 +2,17 @@
 #include <QtMath>
 #include <QMouseEvent>
 #include <QPainter>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFontMetricsF>
 #include <QPalette>
+#include <QScreen>
+#include <QSignalBlocker>
 #include <QTabletEvent>
 #include <QWheelEvent>
 #include <QPlainTextEdit>
+#include <QStandardPaths>
 #include <QTextDocument>
 #include <QTimer>
 #include <QKeyEvent>
@@ -14,9 +21,11 @@
 #include <QApplication>
 #include <algorithm>
 
+#include "canvas/InputRecorder.h"
 #include "model/Commands.h"
 #include "model/Document.h"
 #include "shapes/ShapeRecognizer.h"
+#include "trace/Trace.h"
 
 // Constant for the resize handle hit area
 const double kHandleSizeView = 12.0;
@@ -29,6 +38,16 @@ CanvasWidget::CanvasWidget(QWidget *parent) : QWidget(parent)
     setFocusPolicy(Qt::StrongFocus);
     setTool(Tool::Pen);
     timer_.start();
+
+    // Pen input is applied and repainted at display cadence rather than once
+    // per tablet/mouse event.
+    frameTimer_ = new QTimer(this);
+    frameTimer_->setSingleShot(true);
+    frameTimer_->setTimerType(Qt::PreciseTimer);
+    connect(frameTimer_, &QTimer::timeout, this, [this]()
+            {
+        flushPendingSamples();
+        update(); });
 }
 
 void CanvasWidget::setDocument(Document *doc)
@@ -38,9 +57,36 @@ void CanvasWidget::setDocument(Document *doc)
     if (doc_)
         disconnect(doc_, nullptr, this, nullptr);
     doc_ = doc;
+    textLayouts_.clear();
     if (doc_)
     {
-        connect(doc_, &Document::changed, this, [this]()
+        // Edits repaint only the area they touch; a batch (loading) or a
+        // reset repaints everything once at the end.
+        connect(doc_, &Document::strokeAdded, this, [this](qint64, int, const QRectF &ink)
+                { updateWorldRect(ink); });
+        connect(doc_, &Document::strokeRemoved, this, [this](qint64, int, const QRectF &ink)
+                { updateWorldRect(ink); });
+        connect(doc_, &Document::strokeModified, this, [this](qint64, int, const QRectF &oldInk, const QRectF &newInk)
+                { updateWorldRect(oldInk.united(newInk)); });
+        connect(doc_, &Document::textBoxAdded, this, [this](qint64, const QRectF &r)
+                { updateWorldRect(r); });
+        connect(doc_, &Document::textBoxRemoved, this, [this](qint64 id, const QRectF &r)
+                {
+                    textLayouts_.remove(id);
+                    updateWorldRect(r); });
+        connect(doc_, &Document::textBoxChanged, this, [this](qint64 id, const QRectF &oldRect, const QRectF &newRect)
+                {
+                    if (id == editorBaseId_)
+                        syncEditorFromDocument();
+                    updateWorldRect(oldRect.united(newRect)); });
+        // Typing reaches the document at once but its undo entry only when
+        // the commit timer fires; push it before the stack moves.
+        connect(doc_, &Document::aboutToUndoRedo, this, &CanvasWidget::commitEditorText);
+        connect(doc_, &Document::documentReset, this, [this]()
+                {
+                    textLayouts_.clear();
+                    update(); });
+        connect(doc_, &Document::batchFinished, this, [this]()
                 { update(); });
     }
     update();
@@ -50,7 +96,8 @@ void CanvasWidget::setTool(Tool tool)
 {
     tool_ = tool;
     isDrawing_ = false;
-    draft_.clear();
+    draft_ = Stroke{};
+    pendingSamples_.clear();
     switch (tool) {
         case Tool::Pen:
             setCursor(Qt::CrossCursor); // Precise crosshair for drawing
@@ -88,6 +135,14 @@ void CanvasWidget::setTool(Tool tool)
     update();
 }
 
+void CanvasWidget::centerOn(const QRectF &worldRect)
+{
+    panViewPx_ = QRectF(rect()).center() - worldRect.center() * zoom_;
+    if (editor_ && editor_->isVisible())
+        startEditingTextBox(activeTextId_);
+    update();
+}
+
 void CanvasWidget::setViewMode(ViewMode mode)
 {
     viewMode_ = mode;
@@ -160,6 +215,13 @@ void CanvasWidget::setSmartShapesEnabled(bool enabled)
     update();
 }
 
+void CanvasWidget::setInkPrediction(const StrokePredictionOptions &opts)
+{
+    prediction_ = opts;
+    predictedInk_.clear();
+    update();
+}
+
 QPointF CanvasWidget::viewToWorld(const QPointF &viewPos) const { return (viewPos - panViewPx_) / zoom_; }
 QPointF CanvasWidget::worldToView(const QPointF &worldPos) const { return (worldPos * zoom_) + panViewPx_; }
 
@@ -170,39 +232,85 @@ QRectF CanvasWidget::viewToWorld(const QRectF &viewRect) const
     return QRectF(tl, br).normalized();
 }
 
-void CanvasWidget::beginStroke(const QPointF &worldPos, float pressure)
+// Repaints the part of the view showing `worldRect`, with a margin for
+// antialiasing and text box handles. Batches repaint once when they end.
+void CanvasWidget::updateWorldRect(const QRectF &worldRect)
+{
+    if (doc_ && doc_->isInBatch())
+        return;
+    const int pad = qCeil(kHandleSizeView);
+    const QRectF vr = QRectF(worldToView(worldRect.topLeft()), worldToView(worldRect.bottomRight())).normalized();
+    update(vr.toAlignedRect().adjusted(-pad, -pad, pad, pad));
+}
+
+void CanvasWidget::beginStroke(const QPointF &worldPos, float pressure, qint64 tMs)
 {
     isDrawing_ = true;
-    draft_.clear();
-    draft_.reserve(512);
-    draftColor_ = penColor_;
-    draftBaseWidthPoints_ = penWidthPoints_;
-    draft_.push_back(DraftPoint{worldPos, pressure, timer_.elapsed()});
+    pendingSamples_.clear();
+    predictedInk_.clear();
+    noteSampleArrival(tMs);
+    draft_ = Stroke{};
+    draft_.color = penColor_;
+    draft_.baseWidthPoints = penWidthPoints_;
+    draft_.pts.reserve(512);
+    filter_.reset(filterOptions_, 1.0 / zoom_);
+    StrokePoint first;
+    if (filter_.push(StrokePoint{worldPos, pressure, tMs}, &first))
+        draft_.pts.append(first.worldPos, first.pressure, first.tMs);
     update();
 }
 
-void CanvasWidget::appendStrokePoint(const QPointF &worldPos, float pressure)
+void CanvasWidget::appendStrokePoint(const QPointF &worldPos, float pressure, qint64 tMs)
 {
     if (!isDrawing_)
         return;
-    if (!draft_.isEmpty())
+    pendingSamples_.push_back(StrokePoint{worldPos, pressure, tMs});
+    noteSampleArrival(tMs);
+    if (!frameTimer_->isActive())
     {
-        const QPointF prev = draft_.back().worldPos;
-        if (QLineF(prev, worldPos).length() < 0.3)
-            return;
+        const qreal hz = screen() ? screen()->refreshRate() : 60.0;
+        frameTimer_->start(std::max(1, qRound(1000.0 / std::max<qreal>(hz, 1.0))));
     }
-    draft_.push_back(DraftPoint{worldPos, pressure, timer_.elapsed()});
-    update();
 }
 
-static double distPointToSegment(const QPointF &p, const QPointF &a, const QPointF &b)
+void CanvasWidget::flushPendingSamples()
 {
-    const QPointF ab = b - a;
-    const double ab2 = QPointF::dotProduct(ab, ab);
-    if (ab2 <= 1e-9)
-        return QLineF(p, a).length();
-    double t = std::clamp(QPointF::dotProduct(p - a, ab) / ab2, 0.0, 1.0);
-    return QLineF(p, a + ab * t).length();
+    if (pendingSamples_.isEmpty())
+        return;
+    if (isDrawing_)
+    {
+        draft_.pts.reserve(draft_.pts.size() + pendingSamples_.size());
+        StrokePoint out;
+        for (const StrokePoint &sp : pendingSamples_)
+        {
+            if (!filter_.push(sp, &out))
+                continue;
+            // Unfiltered input still skips near-duplicate samples.
+            if (!filterOptions_.enabled && !draft_.pts.isEmpty() &&
+                QLineF(draft_.pts.pos(draft_.pts.size() - 1), out.worldPos).length() < 0.3)
+                continue;
+            draft_.pts.append(out.worldPos, out.pressure, out.tMs);
+        }
+    }
+    pendingSamples_.clear();
+}
+
+// Event timestamps use the platform's clock. The smallest arrival-minus-
+// timestamp seen so far maps them onto ours (it's the fastest delivery), so
+// latency can be measured from when a sample was generated.
+void CanvasWidget::noteSampleArrival(qint64 eventMs)
+{
+    lastSampleMs_ = timer_.elapsed();
+    eventClockOffsetMs_ = std::min(eventClockOffsetMs_, lastSampleMs_ - eventMs);
+    if (oldestUnpaintedEventMs_ < 0)
+        oldestUnpaintedEventMs_ = eventMs;
+}
+
+// Event timestamps come from the platform and keep the real spacing of
+// coalesced samples; fall back to our own clock if there is none.
+qint64 CanvasWidget::sampleTime(const QInputEvent *e) const
+{
+    return e->timestamp() ? static_cast<qint64>(e->timestamp()) : timer_.elapsed();
 }
 
 void CanvasWidget::eraseAt(const QPointF &worldPos, double radiusWorld)
@@ -212,16 +320,7 @@ void CanvasWidget::eraseAt(const QPointF &worldPos, double radiusWorld)
     const auto &strokes = doc_->strokes();
     for (int i = (int)strokes.size() - 1; i >= 0; --i)
     {
-        bool hit = false;
-        for (int j = 1; j < strokes[i].pts.size(); ++j)
-        {
-            if (distPointToSegment(worldPos, strokes[i].pts[j - 1].worldPos, strokes[i].pts[j].worldPos) <= radiusWorld)
-            {
-                hit = true;
-                break;
-            }
-        }
-        if (hit)
+        if (strokes[i].pts.size() >= 2 && strokes[i].pts.intersectsDisc(worldPos, radiusWorld))
         {
             doc_->undoStack()->push(new RemoveStrokeCommand(doc_, i));
             return;
@@ -233,31 +332,34 @@ void CanvasWidget::endStroke()
 {
     if (!isDrawing_)
         return;
+    flushPendingSamples();
+    StrokePoint last;
+    if (filter_.finish(&last))
+        draft_.pts.append(last.worldPos, last.pressure, last.tMs);
+    frameTimer_->stop();
+    predictedInk_.clear();
     isDrawing_ = false;
-    if (!doc_ || draft_.size() < 2)
+    if (!doc_ || draft_.pts.size() < 2)
     {
-        draft_.clear();
+        draft_ = Stroke{};
         update();
         return;
     }
 
-    Stroke s;
-    s.id = doc_->nextStrokeId();
-    s.color = draftColor_;
-    s.baseWidthPoints = draftBaseWidthPoints_;
-    for (const auto &dp : draft_)
-        s.pts.push_back(StrokePoint{dp.worldPos, dp.pressure, (int)dp.tMs});
-
-    doc_->undoStack()->push(new AddStrokeCommand(doc_, std::move(s)));
+    // The draft's columns are moved, not copied, into the command and from
+    // there into the document.
+    draft_.id = doc_->nextStrokeId();
+    const qint64 id = draft_.id;
+    doc_->undoStack()->push(new AddStrokeCommand(doc_, std::move(draft_)));
+    draft_ = Stroke{};
     if (smartShapesEnabled_)
     {
         const ShapeMatch m = ShapeRecognizer::recognize(doc_->strokes().back());
         if (m.matched && m.score >= 0.7)
         {
-            doc_->undoStack()->push(new SetStrokeShapeCommand(doc_, s.id, true, m.type, m.params));
+            doc_->undoStack()->push(new SetStrokeShapeCommand(doc_, id, true, m.type, m.params));
         }
     }
-    draft_.clear();
     update();
 }
 
@@ -307,7 +409,7 @@ void CanvasWidget::mousePressEvent(QMouseEvent *e)
 
     if (tool_ == Tool::Pen)
     {
-        beginStroke(world, 1.0f);
+        beginStroke(world, 1.0f, sampleTime(e));
         e->accept();
     }
     else if (tool_ == Tool::Eraser)
@@ -398,8 +500,12 @@ void CanvasWidget::mouseMoveEvent(QMouseEvent *e)
     }
 
     if (tool_ == Tool::Pen && isDrawing_)
-        appendStrokePoint(world, 1.0f);
-    else if (tool_ == Tool::Eraser && (e->buttons() & Qt::LeftButton))
+    {
+        // Repainted on the next frame tick.
+        appendStrokePoint(world, 1.0f, sampleTime(e));
+        return;
+    }
+    if (tool_ == Tool::Eraser && (e->buttons() & Qt::LeftButton))
         eraseAt(world, 10.0 / zoom_);
     update();
 }
@@ -444,6 +550,61 @@ void CanvasWidget::wheelEvent(QWheelEvent *e)
 
 void CanvasWidget::keyPressEvent(QKeyEvent *e)
 {
+    // F3 toggles the frame stats HUD; Shift+F3 dumps them (CSV and Chrome
+    // trace) to the temp directory, plus the span trace if tracing is on.
+    if (e->key() == Qt::Key_F3)
+    {
+        if (e->modifiers().testFlag(Qt::ShiftModifier))
+        {
+            const QString base = QDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation))
+                                     .filePath("vellum-frames-" + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"));
+            QString err;
+            if (dumpFrameStats(base + ".csv", &err) && dumpFrameStats(base + ".json", &err))
+                qInfo().noquote() << "Frame stats written to" << base + ".{csv,json}";
+            else
+                qWarning().noquote() << "Cannot write frame stats:" << err;
+            if (Tracer::isEnabled())
+            {
+                if (Tracer::writeChromeTrace(base + ".trace.json", &err))
+                    qInfo().noquote() << "Trace written to" << base + ".trace.json";
+                else
+                    qWarning().noquote() << "Cannot write trace:" << err;
+            }
+        }
+        else
+        {
+            setStatsOverlayVisible(!statsOverlay_);
+        }
+        e->accept();
+        return;
+    }
+
+    // F4 starts recording pointer input; pressing it again writes the
+    // recording to the temp directory for InputReplayer / vellum_bench.
+    if (e->key() == Qt::Key_F4)
+    {
+        if (!recorder_)
+            recorder_ = new InputRecorder(this, this);
+        if (!recorder_->isRecording())
+        {
+            recorder_->start();
+            qInfo().noquote() << "Recording input (F4 to stop)";
+        }
+        else
+        {
+            recorder_->stop();
+            const QString path = QDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation))
+                                     .filePath("vellum-input-" + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + ".vinput");
+            QString err;
+            if (InputRecorder::save(path, recorder_->recording(), &err))
+                qInfo().noquote() << "Input recording written to" << path;
+            else
+                qWarning().noquote() << "Cannot write input recording:" << err;
+        }
+        e->accept();
+        return;
+    }
+
     if ((e->key() == Qt::Key_Delete || e->key() == Qt::Key_Backspace) && activeTextId_ >= 0)
     {
         if (!editor_ || !editor_->hasFocus())
@@ -469,9 +630,9 @@ void CanvasWidget::tabletEvent(QTabletEvent *e)
     if (tool_ == Tool::Pen)
     {
         if (e->type() == QEvent::TabletPress)
-            beginStroke(world, pressure);
+            beginStroke(world, pressure, sampleTime(e));
         else if (e->type() == QEvent::TabletMove)
-            appendStrokePoint(world, pressure);
+            appendStrokePoint(world, pressure, sampleTime(e));
         else if (e->type() == QEvent::TabletRelease)
             endStroke();
         e->accept();
@@ -495,7 +656,7 @@ void CanvasWidget::tabletEvent(QTabletEvent *e)
 //     p.setPen(QPen(QColor("#dcdcdc"), 1));
 //     p.drawRect(pageRect);
 // }
-void CanvasWidget::drawStrokes(QPainter &p) const
+int CanvasWidget::drawStrokes(QPainter &p, const QRectF &worldClip) const
 {
     auto drawS = [&](const Stroke &s)
     {
@@ -531,23 +692,45 @@ void CanvasWidget::drawStrokes(QPainter &p) const
         }
         for (int i = 1; i < s.pts.size(); ++i)
         {
-            pen.setWidthF(s.baseWidthPoints * s.pts[i].pressure * zoom_);
+            pen.setWidthF(s.baseWidthPoints * s.pts.pressure(i) * zoom_);
             p.setPen(pen);
-            p.drawLine(worldToView(s.pts[i - 1].worldPos), worldToView(s.pts[i].worldPos));
+            p.drawLine(worldToView(s.pts.pos(i - 1)), worldToView(s.pts.pos(i)));
         }
     };
+    int drawn = 0;
     if (doc_)
-        for (const auto &s : doc_->strokes())
-            drawS(s);
-    if (isDrawing_ && draft_.size() >= 2)
     {
-        Stroke s;
-        s.color = draftColor_;
-        s.baseWidthPoints = draftBaseWidthPoints_;
-        for (const auto &dp : draft_)
-            s.pts.push_back(StrokePoint{dp.worldPos, dp.pressure, (int)dp.tMs});
-        drawS(s);
+        const auto &strokes = doc_->strokes();
+        const auto &bounds = doc_->strokeBounds();
+        for (int i = 0; i < strokes.size(); ++i)
+        {
+            if (!Document::inkBounds(strokes[i], bounds[i]).intersects(worldClip))
+                continue;
+            drawS(strokes[i]);
+            ++drawn;
+        }
+    }
+    if (isDrawing_ && draft_.pts.size() >= 2)
+    {
+        drawS(draft_);
+        if (!predictedInk_.isEmpty())
+        {
+            // Same look as the real ink; it's redrawn from fresh samples
+            // every frame.
+            const qsizetype n = draft_.pts.size();
+            QPen pen(draft_.color, draft_.baseWidthPoints * draft_.pts.pressure(n - 1) * zoom_,
+                     Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+            p.setPen(pen);
+            QPointF prev = worldToView(draft_.pts.pos(n - 1));
+            for (const QPointF &w : predictedInk_)
+            {
+                const QPointF cur = worldToView(w);
+                p.drawLine(prev, cur);
+                prev = cur;
+            }
+        }
     }
+    return drawn;
 }
 
 void CanvasWidget::drawTextBoxes(QPainter &p) const
@@ -568,23 +751,64 @@ void CanvasWidget::drawTextBoxes(QPainter &p) const
             p.drawRect(vr.right() - 4, vr.bottom() - 4, 8, 8);
         }
 
-        QTextDocument d;
-        d.setDefaultFont(currentFont_);
-        d.setDocumentMargin(5);
-        d.setMarkdown(tb.markdown);
-        d.setTextWidth(vr.width());
+        const std::shared_ptr<QTextDocument> d = textLayout(tb, vr.width());
         p.save();
         p.translate(vr.topLeft());
-        d.drawContents(&p);
+        d->drawContents(&p);
         p.restore();
     }
 }
 
-void CanvasWidget::paintEvent(QPaintEvent *)
+std::shared_ptr<QTextDocument> CanvasWidget::textLayout(const TextBox &tb, double viewWidth) const
 {
+    // Parsing and laying out markdown is most of the cost of drawing a box;
+    // only an edit, a zoom or a font change needs a new layout.
+    if (TextLayout *l = textLayouts_.find(tb.id))
+    {
+        if (l->width == viewWidth && l->font == currentFont_ && l->markdown == tb.markdown)
+            return l->doc;
+    }
+    auto d = std::make_shared<QTextDocument>();
+    d->setDefaultFont(currentFont_);
+    d->setDocumentMargin(5);
+    d->setMarkdown(tb.markdown);
+    d->setTextWidth(viewWidth);
+    // Rough: the source plus per-character layout and glyph data.
+    const qint64 bytes = 4096 + tb.markdown.size() * qint64(sizeof(QChar) + 48);
+    textLayouts_.insert(tb.id, TextLayout{tb.markdown, currentFont_, viewWidth, d}, bytes);
+    return d;
+}
+
+void CanvasWidget::paintEvent(QPaintEvent *e)
+{
+    VELLUM_TRACE_SCOPE("canvas", "CanvasWidget::paintEvent");
+    QElapsedTimer frame;
+    frame.start();
+    FrameSample stats;
+    stats.startUs = timer_.nsecsElapsed() / 1000;
+
+    // Any repaint shows everything received so far.
+    flushPendingSamples();
+    predictedInk_.clear();
+    double predictedLeadMs = 0.0;
+    // Don't extrapolate a pen that has stopped sending samples.
+    if (isDrawing_ && timer_.elapsed() - lastSampleMs_ <= 2 * prediction_.horizonMs)
+    {
+        predictedInk_ = StrokePredictor::predict(draft_.pts, prediction_, &predictedLeadMs);
+    }
+
     QPainter p(this);
     p.setRenderHint(QPainter::Antialiasing);
 
+    qint64 phaseNs = frame.nsecsElapsed();
+    auto phaseMs = [&]()
+    {
+        const qint64 now = frame.nsecsElapsed();
+        const double ms = (now - phaseNs) / 1e6;
+        phaseNs = now;
+        return ms;
+    };
+
     if (viewMode_ == ViewMode::A4Notebook) {
         drawPages(p); // This handles the gray background AND the white page AND the grid
     } else {
@@ -597,8 +821,132 @@ void CanvasWidget::paintEvent(QPaintEvent *)
         // }
     }
 
-    drawStrokes(p);
-    drawTextBoxes(p);
+    stats.pagesMs = phaseMs();
+
+    {
+        VELLUM_TRACE_SCOPE("canvas", "strokes");
+        stats.strokesDrawn = drawStrokes(p, viewToWorld(QRectF(e->rect())));
+    }
+    stats.strokesCulled = doc_ ? int(doc_->strokes().size()) - stats.strokesDrawn : 0;
+    stats.strokesMs = phaseMs();
+
+    {
+        VELLUM_TRACE_SCOPE("canvas", "text boxes");
+        drawTextBoxes(p);
+    }
+    stats.textMs = phaseMs();
+
+    stats.totalMs = frame.nsecsElapsed() / 1e6;
+    if (oldestUnpaintedEventMs_ >= 0)
+    {
+        stats.inputLatencyMs = static_cast<double>(timer_.elapsed() - (oldestUnpaintedEventMs_ + eventClockOffsetMs_));
+        emit inkFrameLatency(stats.inputLatencyMs, predictedLeadMs);
+        oldestUnpaintedEventMs_ = -1;
+    }
+    frameStats_.record(stats);
+
+    // Not part of the measured frame.
+    if (statsOverlay_)
+        drawStatsOverlay(p);
+}
+
+static void drawHistogram(QPainter &p, const QRectF &r, const QVector<int> &bins, const QColor &color)
+{
+    p.fillRect(r, QColor(255, 255, 255, 30));
+    const int peak = std::max(1, *std::max_element(bins.begin(), bins.end()));
+    const double bw = r.width() / bins.size();
+    for (int i = 0; i < bins.size(); ++i)
+    {
+        const double h = r.height() * bins[i] / peak;
+        p.fillRect(QRectF(r.left() + i * bw, r.bottom() - h, std::max(1.0, bw - 1), h), color);
+    }
+}
+
+void CanvasWidget::drawStatsOverlay(QPainter &p) const
+{
+    const QVector<FrameSample> frames = frameStats_.samples();
+    if (frames.isEmpty())
+        return;
+
+    QVector<double> total, pages, strokes, text, latency;
+    for (const auto &f : frames)
+    {
+        total.push_back(f.totalMs);
+        pages.push_back(f.pagesMs);
+        strokes.push_back(f.strokesMs);
+        text.push_back(f.textMs);
+        if (f.inputLatencyMs >= 0)
+            latency.push_back(f.inputLatencyMs);
+    }
+    auto mean = [](const QVector<double> &v)
+    {
+        double sum = 0;
+        for (double x : v)
+            sum += x;
+        return v.isEmpty() ? 0.0 : sum / v.size();
+    };
+    const FrameSample &last = frames.back();
+
+    const QStringList lines = {
+        QString("frame   %1 ms avg  %2 ms p95  (%3 frames)")
+            .arg(mean(total), 0, 'f', 2)
+            .arg(FrameStats::percentile(total, 0.95), 0, 'f', 2)
+            .arg(frames.size()),
+        QString("pages %1  strokes %2  text %3 ms avg")
+            .arg(mean(pages), 0, 'f', 2)
+            .arg(mean(strokes), 0, 'f', 2)
+            .arg(mean(text), 0, 'f', 2),
+        QString("strokes drawn %1  culled %2").arg(last.strokesDrawn).arg(last.strokesCulled),
+        latency.isEmpty() ? QString("input->paint  -")
+                          : QString("input->paint  %1 ms avg  %2 ms p95")
+                                .arg(mean(latency), 0, 'f', 1)
+                                .arg(FrameStats::percentile(latency, 0.95), 0, 'f', 1),
+    };
+
+    constexpr double kPad = 8, kHistW = 240, kHistH = 36;
+    p.save();
+    p.resetTransform();
+    p.setRenderHint(QPainter::Antialiasing, false);
+    QFont f("monospace");
+    f.setStyleHint(QFont::Monospace);
+    f.setPointSize(9);
+    p.setFont(f);
+    const QFontMetricsF fm(f);
+    const double lineH = fm.height();
+    const QRectF box(kPad, kPad, kHistW + 2 * kPad, lines.size() * lineH + 2 * (kHistH + lineH) + 3 * kPad);
+    p.fillRect(box, QColor(0, 0, 0, 170));
+    p.setPen(Qt::white);
+    double y = box.top() + kPad;
+    for (const QString &l : lines)
+    {
+        p.drawText(QPointF(box.left() + kPad, y + fm.ascent()), l);
+        y += lineH;
+    }
+    // Frame times over 0..33 ms, latency over 0..100 ms.
+    y += kPad;
+    p.drawText(QPointF(box.left() + kPad, y + fm.ascent()), "frame ms 0-33");
+    y += lineH;
+    drawHistogram(p, QRectF(box.left() + kPad, y, kHistW, kHistH), FrameStats::histogram(total, 33, 33.0),
+                  QColor(120, 200, 255));
+    y += kHistH + kPad;
+    p.drawText(QPointF(box.left() + kPad, y + fm.ascent()), "input->paint ms 0-100");
+    y += lineH;
+    drawHistogram(p, QRectF(box.left() + kPad, y, kHistW, kHistH), FrameStats::histogram(latency, 50, 100.0),
+                  QColor(255, 180, 90));
+    p.restore();
+}
+
+void CanvasWidget::setStatsOverlayVisible(bool visible)
+{
+    statsOverlay_ = visible;
+    update();
+}
+
+bool CanvasWidget::dumpFrameStats(const QString &path, QString *err) const
+{
+    if (path.endsWith(".json", Qt::CaseInsensitive))
+        return frameStats_.writeChromeTrace(path, err);
+    return frameStats_.writeCsv(path, err);
 }
 
 qint64 CanvasWidget::hitTestTextBox(const QPointF &worldPos) const
@@ -673,12 +1021,16 @@ void CanvasWidget::startEditingTextBox(qint64 id)
             editorCommitTimer_->start(500); 
         });
 
-        connect(editorCommitTimer_, &QTimer::timeout, [this]()
-        {
-            if (activeTextId_ < 0) return;
-            int i = doc_->textBoxIndexById(activeTextId_);
-            doc_->undoStack()->push(new SetTextBoxMarkdownCommand(doc_, activeTextId_, doc_->textBoxes()[i].markdown, editor_->toPlainText())); 
-        });
+        connect(editorCommitTimer_, &QTimer::timeout, this, &CanvasWidget::commitEditorText);
+    }
+
+    // Switching boxes: commit what is pending for the old one first, then
+    // remember where the new one's undo entries start from.
+    if (editorBaseId_ != id)
+    {
+        commitEditorText();
+        editorBaseId_ = id;
+        editorBaseText_ = doc_->textBoxes()[idx].markdown;
     }
 
     const auto &tb = doc_->textBoxes()[idx];
@@ -699,6 +1051,42 @@ void CanvasWidget::startEditingTextBox(qint64 id)
     editor_->setTextCursor(cursor);
 }
 
+void CanvasWidget::syncEditorFromDocument()
+{
+    if (!editor_ || editorBaseId_ < 0)
+        return;
+    const int idx = doc_->textBoxIndexById(editorBaseId_);
+    if (idx < 0)
+        return;
+    const QString &md = doc_->textBoxes()[idx].markdown;
+    // Equal after our own per-keystroke sync; only undo/redo changes the
+    // text behind the editor's back.
+    if (md == editor_->toPlainText())
+        return;
+    editorCommitTimer_->stop();
+    editorBaseText_ = md;
+    const QSignalBlocker block(editor_);
+    editor_->setPlainText(md);
+    QTextCursor cursor = editor_->textCursor();
+    cursor.movePosition(QTextCursor::End);
+    editor_->setTextCursor(cursor);
+}
+
+void CanvasWidget::commitEditorText()
+{
+    if (editorCommitTimer_)
+        editorCommitTimer_->stop();
+    if (!doc_ || !editor_ || editorBaseId_ < 0 || doc_->textBoxIndexById(editorBaseId_) < 0)
+        return;
+    const QString text = editor_->toPlainText();
+    if (text == editorBaseText_)
+        return;
+    // The box already holds `text` (synced on every keystroke); the command
+    // records the edit since the last commit and merges with recent ones.
+    doc_->undoStack()->push(new SetTextBoxMarkdownCommand(doc_, editorBaseId_, editorBaseText_, text));
+    editorBaseText_ = text;
+}
+
 void CanvasWidget::updateFontSize(int pointSize)
 {
     currentFont_.setPointSize(pointSize);
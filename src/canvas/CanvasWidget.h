@@ -6,9 +6,20 @@
 #include <QRectF>
 #include <QWidget>
 
+#include <limits>
+#include <memory>
+
+#include "cache/CacheBudget.h"
+#include "canvas/FrameStats.h"
+#include "canvas/StrokeFilter.h"
+#include "canvas/StrokePredictor.h"
+#include "model/Stroke.h"
+
 class QPainter;
+class QTextDocument;
 
 class Document;
+struct TextBox;
 
 class CanvasWidget : public QWidget {
   Q_OBJECT
@@ -35,6 +46,8 @@ class CanvasWidget : public QWidget {
   Document* document() const { return doc_; }
 
   QRectF currentViewportWorld() const;
+  // Pans (keeping the zoom) so `worldRect` is centered, e.g. a search hit.
+  void centerOn(const QRectF& worldRect);
 
   void setTool(Tool tool);
   Tool tool() const { return tool_; }
@@ -51,12 +64,34 @@ class CanvasWidget : public QWidget {
   void setSmartShapesEnabled(bool enabled);
   bool smartShapesEnabled() const { return smartShapesEnabled_; }
 
+  // Smoothing and resampling applied to pen samples before they're stored.
+  void setStrokeFilter(const StrokeFilterOptions& opts) { filterOptions_ = opts; }
+  const StrokeFilterOptions& strokeFilter() const { return filterOptions_; }
+
+  // Per-frame paint timings, culling counts and input latency. The HUD is
+  // also toggled with F3.
+  void setStatsOverlayVisible(bool visible);
+  bool statsOverlayVisible() const { return statsOverlay_; }
+  const FrameStats& frameStats() const { return frameStats_; }
+  // Chrome trace if `path` ends in .json, CSV otherwise.
+  bool dumpFrameStats(const QString& path, QString* err) const;
+
+  // Predicted ink drawn ahead of the live stroke; never committed.
+  void setInkPrediction(const StrokePredictionOptions& opts);
+  const StrokePredictionOptions& inkPrediction() const { return prediction_; }
+
   // Font control methods
     void updateFontSize(int pointSize);
     void updateFontFamily(const QString &family);
     void setFontSize(int points); // Alias for consistency
     void setFontFamily(const QString &family); // Alias for consistency
 
+ signals:
+  // Emitted after each frame that shows new pen samples: time from the
+  // oldest of them being generated to the frame being painted, and how far
+  // ahead of the newest sample the predicted ink reached.
+  void inkFrameLatency(double inputToPaintMs, double predictedLeadMs);
+
  protected:
   void paintEvent(QPaintEvent* e) override;
   void mousePressEvent(QMouseEvent* e) override;
@@ -67,29 +102,37 @@ class CanvasWidget : public QWidget {
   void keyPressEvent(QKeyEvent *e) override;
 
  private:
-  struct DraftPoint {
-    QPointF worldPos;
-    float pressure = 1.0f;
-    qint64 tMs = 0;
-  };
-
   PageType pageType_ = PageType::Plain;
 
 
   QPointF viewToWorld(const QPointF& viewPos) const;
   QPointF worldToView(const QPointF& worldPos) const;
   QRectF viewToWorld(const QRectF& viewRect) const;
+  void updateWorldRect(const QRectF& worldRect);
 
-  void beginStroke(const QPointF& worldPos, float pressure);
-  void appendStrokePoint(const QPointF& worldPos, float pressure);
+  void beginStroke(const QPointF& worldPos, float pressure, qint64 tMs);
+  // Queues a sample; queued samples reach the draft once per frame.
+  void appendStrokePoint(const QPointF& worldPos, float pressure, qint64 tMs);
+  void flushPendingSamples();
+  void noteSampleArrival(qint64 eventMs);
   void endStroke();
+  qint64 sampleTime(const class QInputEvent* e) const;
   void eraseAt(const QPointF& worldPos, double radiusWorld);
 
   void drawPages(QPainter& p) const;
-  void drawStrokes(QPainter& p) const;
+  // Draws the strokes whose ink touches `worldClip` and returns how many;
+  // the rest were culled.
+  int drawStrokes(QPainter& p, const QRectF& worldClip) const;
+  void drawStatsOverlay(QPainter& p) const;
   void drawTextBoxes(QPainter& p) const;
+  // Laid-out markdown for a box at the current view width, built on a miss.
+  std::shared_ptr<QTextDocument> textLayout(const TextBox& tb, double viewWidth) const;
   qint64 hitTestTextBox(const QPointF& worldPos) const;
   void startEditingTextBox(qint64 id);
+  void commitEditorText();
+  // Undo/redo can rewrite the box being edited; reloads the editor and its
+  // undo base from the document so the next keystroke doesn't revert it.
+  void syncEditorFromDocument();
 
 
   Document* doc_ = nullptr;
@@ -101,10 +144,25 @@ class CanvasWidget : public QWidget {
   double penWidthPoints_ = 2.0;
   bool smartShapesEnabled_ = true;
 
-  QVector<DraftPoint> draft_;
-  QColor draftColor_;
-  double draftBaseWidthPoints_ = 2.0;
+  // Stroke being drawn; painted in place and moved into the document on
+  // pen up.
+  Stroke draft_;
   bool isDrawing_ = false;
+  // Pen samples received since the last frame, with their event timestamps.
+  QVector<StrokePoint> pendingSamples_;
+  class QTimer* frameTimer_ = nullptr;
+  qint64 lastSampleMs_ = -1;            // arrival of the newest sample
+  qint64 oldestUnpaintedEventMs_ = -1;  // event time of the oldest sample not yet shown
+  qint64 eventClockOffsetMs_ = std::numeric_limits<qint64>::max();  // event clock -> timer_
+
+  FrameStats frameStats_;
+  bool statsOverlay_ = false;
+  class InputRecorder* recorder_ = nullptr;  // created on first F4
+
+  StrokeFilterOptions filterOptions_;
+  StrokeFilter filter_;
+  StrokePredictionOptions prediction_;
+  QVector<QPointF> predictedInk_;
 
   bool isPanning_ = false;
   QPointF lastPanViewPos_;
@@ -121,6 +179,17 @@ class CanvasWidget : public QWidget {
   QRectF dragStartRect_;
   class QPlainTextEdit* editor_ = nullptr;
   class QTimer* editorCommitTimer_ = nullptr;
+  qint64 editorBaseId_ = -1;   // box the editor's pending edits belong to
+  QString editorBaseText_;     // its text as of the last undo entry
+
+  // Parsed and laid-out text boxes by id; counts against CacheBudget.
+  struct TextLayout {
+    QString markdown;
+    QFont font;
+    double width = 0;
+    std::shared_ptr<QTextDocument> doc;
+  };
+  mutable BudgetedCache<qint64, TextLayout> textLayouts_{"text layouts"};
 
   QElapsedTimer timer_;
 };
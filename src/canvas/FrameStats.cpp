@@ -0,0 +1,118 @@
+#include "FrameStats.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <algorithm>
+
+FrameStats::FrameStats(int capacity) : ring_(std::max(1, capacity)) {}
+
+void FrameStats::record(const FrameSample& f) {
+  ring_[next_] = f;
+  next_ = (next_ + 1) % ring_.size();
+  count_ = std::min<int>(count_ + 1, ring_.size());
+}
+
+void FrameStats::clear() {
+  next_ = 0;
+  count_ = 0;
+}
+
+QVector<FrameSample> FrameStats::samples() const {
+  QVector<FrameSample> out;
+  out.reserve(count_);
+  const int first = (next_ - count_ + ring_.size()) % ring_.size();
+  for (int i = 0; i < count_; ++i) out.push_back(ring_[(first + i) % ring_.size()]);
+  return out;
+}
+
+QVector<int> FrameStats::histogram(const QVector<double>& values, int bins, double maxValue) {
+  QVector<int> h(std::max(1, bins), 0);
+  if (maxValue <= 0) return h;
+  for (double v : values) {
+    const int b = static_cast<int>(v / maxValue * h.size());
+    ++h[std::clamp(b, 0, int(h.size()) - 1)];
+  }
+  return h;
+}
+
+double FrameStats::percentile(QVector<double> values, double p) {
+  if (values.isEmpty()) return 0;
+  const qsizetype k = std::clamp<qsizetype>(qsizetype(p * (values.size() - 1) + 0.5), 0, values.size() - 1);
+  std::nth_element(values.begin(), values.begin() + k, values.end());
+  return values[k];
+}
+
+static bool commit(QSaveFile& f, QString* err) {
+  if (f.commit()) return true;
+  if (err) *err = f.errorString();
+  return false;
+}
+
+bool FrameStats::writeCsv(const QString& path, QString* err) const {
+  QSaveFile f(path);
+  if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (err) *err = f.errorString();
+    return false;
+  }
+  QTextStream out(&f);
+  out << "start_us,total_ms,pages_ms,strokes_ms,text_ms,strokes_drawn,strokes_culled,input_latency_ms\n";
+  for (const auto& s : samples()) {
+    out << s.startUs << ',' << s.totalMs << ',' << s.pagesMs << ',' << s.strokesMs << ',' << s.textMs << ','
+        << s.strokesDrawn << ',' << s.strokesCulled << ',';
+    if (s.inputLatencyMs >= 0) out << s.inputLatencyMs;
+    out << '\n';
+  }
+  out.flush();
+  return commit(f, err);
+}
+
+bool FrameStats::writeChromeTrace(const QString& path, QString* err) const {
+  QJsonArray events;
+  auto slice = [&](const char* name, double tsUs, double durMs) {
+    QJsonObject e;
+    e["name"] = name;
+    e["cat"] = "canvas";
+    e["ph"] = "X";
+    e["ts"] = tsUs;
+    e["dur"] = durMs * 1000.0;
+    e["pid"] = 1;
+    e["tid"] = 1;
+    events.append(e);
+  };
+  auto counter = [&](const char* name, double tsUs, const QJsonObject& args) {
+    QJsonObject e;
+    e["name"] = name;
+    e["ph"] = "C";
+    e["ts"] = tsUs;
+    e["pid"] = 1;
+    e["args"] = args;
+    events.append(e);
+  };
+
+  for (const auto& s : samples()) {
+    const double ts = double(s.startUs);
+    slice("frame", ts, s.totalMs);
+    // Phases run back to back in paintEvent.
+    slice("drawPages", ts, s.pagesMs);
+    slice("drawStrokes", ts + s.pagesMs * 1000.0, s.strokesMs);
+    slice("drawTextBoxes", ts + (s.pagesMs + s.strokesMs) * 1000.0, s.textMs);
+    counter("strokes", ts, QJsonObject{{"drawn", s.strokesDrawn}, {"culled", s.strokesCulled}});
+    if (s.inputLatencyMs >= 0) counter("input_latency_ms", ts, QJsonObject{{"ms", s.inputLatencyMs}});
+  }
+
+  QJsonObject root;
+  root["traceEvents"] = events;
+  root["displayTimeUnit"] = "ms";
+
+  QSaveFile f(path);
+  if (!f.open(QIODevice::WriteOnly)) {
+    if (err) *err = f.errorString();
+    return false;
+  }
+  f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+  return commit(f, err);
+}
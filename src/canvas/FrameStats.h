@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+// One painted frame of the canvas.
+struct FrameSample {
+  qint64 startUs = 0;  // frame start on the widget's monotonic clock
+  double pagesMs = 0;
+  double strokesMs = 0;
+  double textMs = 0;
+  double totalMs = 0;
+  int strokesDrawn = 0;
+  int strokesCulled = 0;
+  // Pen sample generation (per event timestamps) to paint, for frames that
+  // showed new samples; negative otherwise.
+  double inputLatencyMs = -1;
+};
+
+// Fixed-size history of recent frames for the HUD and for dumping.
+class FrameStats {
+ public:
+  explicit FrameStats(int capacity = 600);
+
+  void record(const FrameSample& f);
+  void clear();
+
+  // Oldest first.
+  QVector<FrameSample> samples() const;
+  bool isEmpty() const { return count_ == 0; }
+
+  // Counts of `values` in `bins` equal-width bins over [0, maxValue); the
+  // last bin also takes everything above.
+  static QVector<int> histogram(const QVector<double>& values, int bins, double maxValue);
+  // p in [0, 1]; 0 for an empty list.
+  static double percentile(QVector<double> values, double p);
+
+  // One row per frame.
+  bool writeCsv(const QString& path, QString* err) const;
+  // Chrome trace (chrome://tracing, Perfetto): a slice per frame with the
+  // three paint phases nested, plus counters for culling and latency.
+  bool writeChromeTrace(const QString& path, QString* err) const;
+
+ private:
+  QVector<FrameSample> ring_;
+  int next_ = 0;
+  int count_ = 0;
+};
@@ -0,0 +1,168 @@
+#include "InputRecorder.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QMouseEvent>
+#include <QSaveFile>
+#include <QTabletEvent>
+#include <QWheelEvent>
+
+#include <algorithm>
+
+#include "canvas/CanvasWidget.h"
+
+// File layout: magic, version, view size, sample count, then per sample
+// kind, tMs, pos, pressure, button, buttons, modifiers, angleDelta, tool.
+static constexpr quint32 kMagic = 0x56494e50;  // "VINP"
+static constexpr quint16 kVersion = 1;
+// Lower bound on one serialized sample (kind, time, pos, pressure, three
+// flag words, wheel delta, tool), to sanity-check counts read from a file.
+static constexpr qint64 kMinSampleBytes = 1 + 8 + 16 + 4 + 3 * 4 + 8 + 4;
+
+InputRecorder::InputRecorder(CanvasWidget* canvas, QObject* parent) : QObject(parent), canvas_(canvas) {
+  canvas_->installEventFilter(this);
+}
+
+void InputRecorder::start() {
+  rec_ = InputRecording{};
+  rec_.viewSize = canvas_->size();
+  lastTool_ = -1;
+  firstTimestamp_ = 0;
+  clock_.start();
+  recording_ = true;
+  noteTool(0);
+}
+
+void InputRecorder::stop() {
+  recording_ = false;
+}
+
+// Event timestamps keep the real spacing of coalesced samples; our own
+// clock stands in on platforms that don't provide them.
+qint64 InputRecorder::sampleTime(const QInputEvent* e) {
+  if (e->timestamp() == 0) return clock_.elapsed();
+  if (firstTimestamp_ == 0) firstTimestamp_ = e->timestamp() - static_cast<quint64>(clock_.elapsed());
+  return static_cast<qint64>(e->timestamp() - firstTimestamp_);
+}
+
+void InputRecorder::noteTool(qint64 tMs) {
+  const int tool = static_cast<int>(canvas_->tool());
+  if (tool == lastTool_) return;
+  lastTool_ = tool;
+  InputSample s;
+  s.kind = InputSample::Kind::SetTool;
+  s.tMs = tMs;
+  s.tool = tool;
+  rec_.samples.push_back(s);
+}
+
+bool InputRecorder::eventFilter(QObject* watched, QEvent* e) {
+  if (!recording_ || watched != canvas_) return false;
+
+  InputSample s;
+  switch (e->type()) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseMove:
+    case QEvent::MouseButtonRelease: {
+      const auto* me = static_cast<QMouseEvent*>(e);
+      s.kind = e->type() == QEvent::MouseButtonPress  ? InputSample::Kind::MousePress
+               : e->type() == QEvent::MouseMove       ? InputSample::Kind::MouseMove
+                                                      : InputSample::Kind::MouseRelease;
+      s.tMs = sampleTime(me);
+      s.pos = me->position();
+      s.button = me->button();
+      s.buttons = me->buttons().toInt();
+      s.modifiers = me->modifiers().toInt();
+      break;
+    }
+    case QEvent::TabletPress:
+    case QEvent::TabletMove:
+    case QEvent::TabletRelease: {
+      const auto* te = static_cast<QTabletEvent*>(e);
+      s.kind = e->type() == QEvent::TabletPress  ? InputSample::Kind::TabletPress
+               : e->type() == QEvent::TabletMove ? InputSample::Kind::TabletMove
+                                                 : InputSample::Kind::TabletRelease;
+      s.tMs = sampleTime(te);
+      s.pos = te->position();
+      s.pressure = static_cast<float>(te->pressure());
+      s.button = te->button();
+      s.buttons = te->buttons().toInt();
+      s.modifiers = te->modifiers().toInt();
+      break;
+    }
+    case QEvent::Wheel: {
+      const auto* we = static_cast<QWheelEvent*>(e);
+      s.kind = InputSample::Kind::Wheel;
+      s.tMs = sampleTime(we);
+      s.pos = we->position();
+      s.buttons = we->buttons().toInt();
+      s.modifiers = we->modifiers().toInt();
+      s.angleDelta = we->angleDelta();
+      break;
+    }
+    default:
+      return false;
+  }
+
+  // Tool switches happen outside the canvas (toolbar, shortcuts); catch
+  // them before the next event they affect.
+  noteTool(s.tMs);
+  rec_.samples.push_back(s);
+  return false;
+}
+
+bool InputRecorder::save(const QString& path, const InputRecording& rec, QString* err) {
+  QSaveFile f(path);
+  if (!f.open(QIODevice::WriteOnly)) {
+    if (err) *err = f.errorString();
+    return false;
+  }
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_6_0);
+  out << kMagic << kVersion << rec.viewSize << quint32(rec.samples.size());
+  for (const auto& s : rec.samples) {
+    out << quint8(s.kind) << s.tMs << s.pos << s.pressure << s.button << s.buttons << s.modifiers
+        << s.angleDelta << qint32(s.tool);
+  }
+  if (f.commit()) return true;
+  if (err) *err = f.errorString();
+  return false;
+}
+
+bool InputRecorder::load(const QString& path, InputRecording* rec, QString* err) {
+  QFile f(path);
+  if (!f.open(QIODevice::ReadOnly)) {
+    if (err) *err = f.errorString();
+    return false;
+  }
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_6_0);
+  quint32 magic = 0;
+  quint16 version = 0;
+  quint32 count = 0;
+  InputRecording r;
+  in >> magic >> version >> r.viewSize >> count;
+  if (magic != kMagic || version != kVersion) {
+    if (err) *err = "Not a vellum input recording";
+    return false;
+  }
+  // A corrupt count must not turn into a huge allocation; the loop below
+  // rejects files that run out early.
+  r.samples.reserve(std::min<qint64>(count, f.size() / kMinSampleBytes));
+  for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+    InputSample s;
+    quint8 kind = 0;
+    qint32 tool = 0;
+    in >> kind >> s.tMs >> s.pos >> s.pressure >> s.button >> s.buttons >> s.modifiers >> s.angleDelta >> tool;
+    if (kind > quint8(InputSample::Kind::SetTool)) break;
+    s.kind = static_cast<InputSample::Kind>(kind);
+    s.tool = tool;
+    r.samples.push_back(s);
+  }
+  if (in.status() != QDataStream::Ok || r.samples.size() != qsizetype(count)) {
+    if (err) *err = "Truncated input recording";
+    return false;
+  }
+  *rec = std::move(r);
+  return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPoint>
+#include <QPointF>
+#include <QSize>
+#include <QVector>
+
+class CanvasWidget;
+
+// One pointer event as the canvas received it. Positions are widget
+// coordinates, so a replay reproduces the session only from the same view
+// (zoom and pan are recorded through the wheel events that change them).
+struct InputSample {
+  enum class Kind : quint8 {
+    MousePress,
+    MouseMove,
+    MouseRelease,
+    TabletPress,
+    TabletMove,
+    TabletRelease,
+    Wheel,
+    SetTool,  // the canvas tool changed since the previous sample
+  };
+
+  Kind kind = Kind::MouseMove;
+  qint64 tMs = 0;  // since the first sample, from event timestamps
+  QPointF pos;
+  float pressure = 1.0f;
+  quint32 button = 0;     // Qt::MouseButton
+  quint32 buttons = 0;    // Qt::MouseButtons
+  quint32 modifiers = 0;  // Qt::KeyboardModifiers
+  QPoint angleDelta;      // Wheel
+  int tool = 0;           // SetTool: CanvasWidget::Tool
+};
+
+struct InputRecording {
+  QSize viewSize;
+  QVector<InputSample> samples;
+
+  qint64 durationMs() const { return samples.isEmpty() ? 0 : samples.back().tMs; }
+};
+
+// Captures the mouse, tablet and wheel events reaching a canvas (through an
+// event filter, so the canvas's handlers are untouched) for InputReplayer.
+class InputRecorder : public QObject {
+  Q_OBJECT
+ public:
+  explicit InputRecorder(CanvasWidget* canvas, QObject* parent = nullptr);
+
+  // Starts a new recording, dropping the previous one.
+  void start();
+  void stop();
+  bool isRecording() const { return recording_; }
+  const InputRecording& recording() const { return rec_; }
+
+  // Binary file (QDataStream); see InputRecorder.cpp for the layout.
+  static bool save(const QString& path, const InputRecording& rec, QString* err);
+  static bool load(const QString& path, InputRecording* rec, QString* err);
+
+ protected:
+  bool eventFilter(QObject* watched, QEvent* e) override;
+
+ private:
+  qint64 sampleTime(const class QInputEvent* e);
+  void noteTool(qint64 tMs);
+
+  CanvasWidget* canvas_;
+  bool recording_ = false;
+  InputRecording rec_;
+  int lastTool_ = -1;
+  quint64 firstTimestamp_ = 0;
+  QElapsedTimer clock_;  // for events without a timestamp
+};
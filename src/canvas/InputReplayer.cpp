@@ -0,0 +1,109 @@
+#include "InputReplayer.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QMouseEvent>
+#include <QPointingDevice>
+#include <QTabletEvent>
+#include <QTimer>
+#include <QWheelEvent>
+
+#include "canvas/CanvasWidget.h"
+#include "canvas/FrameStats.h"
+#include "trace/Trace.h"
+
+// Synthesized tablet events need a stylus to come from.
+static const QPointingDevice* replayStylus() {
+  static const QPointingDevice* stylus = new QPointingDevice(
+      "vellum replay stylus", 1, QInputDevice::DeviceType::Stylus, QPointingDevice::PointerType::Pen,
+      QInputDevice::Capability::Position | QInputDevice::Capability::Pressure, 1, 3, QString(),
+      QPointingDeviceUniqueId(), QCoreApplication::instance());
+  return stylus;
+}
+
+// Recorded times are offset so no event carries timestamp 0, which the
+// canvas reads as "no timestamp".
+static constexpr qint64 kTimestampBase = 1000;
+
+static void send(CanvasWidget* canvas, const InputSample& s) {
+  const QPointF global = canvas->mapToGlobal(s.pos);
+  const auto button = static_cast<Qt::MouseButton>(s.button);
+  const auto buttons = Qt::MouseButtons::fromInt(s.buttons);
+  const auto modifiers = Qt::KeyboardModifiers::fromInt(s.modifiers);
+  const quint64 timestamp = static_cast<quint64>(kTimestampBase + s.tMs);
+
+  switch (s.kind) {
+    case InputSample::Kind::MousePress:
+    case InputSample::Kind::MouseMove:
+    case InputSample::Kind::MouseRelease: {
+      const QEvent::Type type = s.kind == InputSample::Kind::MousePress  ? QEvent::MouseButtonPress
+                                : s.kind == InputSample::Kind::MouseMove ? QEvent::MouseMove
+                                                                         : QEvent::MouseButtonRelease;
+      QMouseEvent e(type, s.pos, global, button, buttons, modifiers);
+      e.setTimestamp(timestamp);
+      QCoreApplication::sendEvent(canvas, &e);
+      break;
+    }
+    case InputSample::Kind::TabletPress:
+    case InputSample::Kind::TabletMove:
+    case InputSample::Kind::TabletRelease: {
+      const QEvent::Type type = s.kind == InputSample::Kind::TabletPress  ? QEvent::TabletPress
+                                : s.kind == InputSample::Kind::TabletMove ? QEvent::TabletMove
+                                                                          : QEvent::TabletRelease;
+      QTabletEvent e(type, replayStylus(), s.pos, global, s.pressure, 0, 0, 0, 0, 0, modifiers, button, buttons);
+      e.setTimestamp(timestamp);
+      QCoreApplication::sendEvent(canvas, &e);
+      break;
+    }
+    case InputSample::Kind::Wheel: {
+      QWheelEvent e(s.pos, global, QPoint(), s.angleDelta, buttons, modifiers, Qt::NoScrollPhase, false);
+      e.setTimestamp(timestamp);
+      QCoreApplication::sendEvent(canvas, &e);
+      break;
+    }
+    case InputSample::Kind::SetTool:
+      canvas->setTool(static_cast<CanvasWidget::Tool>(s.tool));
+      break;
+  }
+}
+
+InputReplayResult InputReplayer::replay(CanvasWidget* canvas, const InputRecording& rec,
+                                        const InputReplayOptions& opts) {
+  VELLUM_TRACE_SCOPE_ARG("canvas", "InputReplayer::replay", rec.samples.size());
+  InputReplayResult result;
+  if (rec.viewSize.isValid()) canvas->resize(rec.viewSize);
+
+  QVector<double> latencies;
+  const auto conn = QObject::connect(canvas, &CanvasWidget::inkFrameLatency, canvas,
+                                     [&](double inputToPaintMs, double) { latencies.push_back(inputToPaintMs); });
+
+  QElapsedTimer wall;
+  wall.start();
+  QEventLoop loop;
+  for (const auto& s : rec.samples) {
+    if (opts.speed > 0) {
+      // Run the event loop (frame ticks, repaints) until the sample is due.
+      const qint64 dueMs = static_cast<qint64>(s.tMs / opts.speed);
+      const qint64 waitMs = dueMs - wall.elapsed();
+      if (waitMs > 0) {
+        QTimer::singleShot(waitMs, Qt::PreciseTimer, &loop, &QEventLoop::quit);
+        loop.exec();
+      }
+    }
+    send(canvas, s);
+    QCoreApplication::processEvents();
+    ++result.events;
+  }
+  result.wallMs = wall.nsecsElapsed() / 1e6;
+  // Let the last frame tick and repaint land.
+  QTimer::singleShot(50, Qt::PreciseTimer, &loop, &QEventLoop::quit);
+  loop.exec();
+  QObject::disconnect(conn);
+
+  result.frames = latencies.size();
+  result.latencyP50Ms = FrameStats::percentile(latencies, 0.5);
+  result.latencyP95Ms = FrameStats::percentile(latencies, 0.95);
+  result.latencyMaxMs = FrameStats::percentile(latencies, 1.0);
+  return result;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "canvas/InputRecorder.h"
+
+class CanvasWidget;
+
+struct InputReplayOptions {
+  // 1 replays at the recorded pace, 4 four times faster; 0 sends events
+  // back to back, only letting the event loop run between them.
+  double speed = 1.0;
+};
+
+struct InputReplayResult {
+  qint64 events = 0;
+  double wallMs = 0;
+  int frames = 0;  // frames that showed new ink
+  // inkFrameLatency over the replay. Only meaningful at speed 1: events
+  // keep their recorded timestamps, so faster replays look late.
+  double latencyP50Ms = 0;
+  double latencyP95Ms = 0;
+  double latencyMaxMs = 0;
+};
+
+// Feeds an InputRecording back into a canvas as synthesized mouse, tablet
+// and wheel events, running the event loop in between so frame ticks and
+// repaints happen as they would live. The canvas should be shown (the
+// offscreen platform is fine) for repaints to be measured.
+class InputReplayer {
+ public:
+  static InputReplayResult replay(CanvasWidget* canvas, const InputRecording& rec,
+                                  const InputReplayOptions& opts = {});
+};
@@ -0,0 +1,79 @@
+#include "StrokeFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr double kPi = 3.14159265358979323846;
+
+void StrokeFilter::reset(const StrokeFilterOptions& opts, double worldPerPixel) {
+  *this = StrokeFilter();
+  opts_ = opts;
+  worldPerPixel_ = worldPerPixel > 0 ? worldPerPixel : 1.0;
+}
+
+double StrokeFilter::alpha(double cutoffHz, double dtSec) {
+  const double tau = 1.0 / (2.0 * kPi * cutoffHz);
+  return 1.0 / (1.0 + tau / dtSec);
+}
+
+bool StrokeFilter::push(const StrokePoint& raw, StrokePoint* out) {
+  if (!opts_.enabled) {
+    *out = raw;
+    return true;
+  }
+
+  // Coalesced samples can share a timestamp; treat them as 1 ms apart.
+  const double dt = haveSample_ ? std::max<qint64>(1, raw.tMs - lastT_) / 1000.0 : 1.0 / 120.0;
+  lastT_ = raw.tMs;
+
+  StrokePoint p = raw;
+  if (haveSample_) {
+    // Speed estimate, smoothed, in view pixels per second.
+    const double ad = alpha(opts_.derivativeCutoffHz, dt);
+    const double vx = dx_.filter((raw.worldPos.x() - x_.y) / dt, ad);
+    const double vy = dy_.filter((raw.worldPos.y() - y_.y) / dt, ad);
+    const double speedPx = std::hypot(vx, vy) / worldPerPixel_;
+    const double a = alpha(opts_.minCutoffHz + opts_.beta * speedPx, dt);
+    p.worldPos = QPointF(x_.filter(raw.worldPos.x(), a), y_.filter(raw.worldPos.y(), a));
+    // Pressure only needs light smoothing.
+    p.pressure = static_cast<float>(pressure_.filter(raw.pressure, alpha(2.0 * opts_.minCutoffHz, dt)));
+  } else {
+    x_.filter(raw.worldPos.x(), 1.0);
+    y_.filter(raw.worldPos.y(), 1.0);
+    pressure_.filter(raw.pressure, 1.0);
+    haveSample_ = true;
+  }
+
+  latest_ = p;
+  latestStored_ = accept(p);
+  if (!latestStored_) return false;
+
+  if (haveEmitted_) {
+    const QPointF d = p.worldPos - lastEmitted_.worldPos;
+    const double len = std::hypot(d.x(), d.y());
+    if (len > 0) lastDir_ = d / len;
+  }
+  lastEmitted_ = p;
+  haveEmitted_ = true;
+  *out = p;
+  return true;
+}
+
+bool StrokeFilter::accept(const StrokePoint& p) const {
+  if (!haveEmitted_) return true;
+  const QPointF d = p.worldPos - lastEmitted_.worldPos;
+  const double distPx = std::hypot(d.x(), d.y()) / worldPerPixel_;
+  if (distPx < opts_.minSpacingPx) return false;
+  if (distPx >= opts_.maxSpacingPx) return true;
+  if (lastDir_.isNull()) return true;
+  // Turn between the last stored segment and the chord to this sample.
+  const double cosTurn = (d.x() * lastDir_.x() + d.y() * lastDir_.y()) / (distPx * worldPerPixel_);
+  return cosTurn < std::cos(opts_.maxTurnDegrees * kPi / 180.0);
+}
+
+bool StrokeFilter::finish(StrokePoint* out) {
+  if (!opts_.enabled || !haveSample_ || latestStored_) return false;
+  latestStored_ = true;
+  *out = latest_;
+  return true;
+}
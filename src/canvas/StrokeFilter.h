@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QPointF>
+
+#include "model/StrokePoints.h"
+
+struct StrokeFilterOptions {
+  bool enabled = true;
+  // One-Euro filter: cutoff at rest and how fast it opens up with speed
+  // (per view pixel/second), so slow strokes lose jitter and fast ones
+  // don't lag.
+  double minCutoffHz = 2.0;
+  double beta = 0.01;
+  double derivativeCutoffHz = 1.0;
+  // Resampling, in view pixels: points closer than minSpacingPx are dropped,
+  // farther than maxSpacingPx always kept, and in between kept once the
+  // path turns by more than maxTurnDegrees.
+  double minSpacingPx = 1.5;
+  double maxSpacingPx = 24.0;
+  double maxTurnDegrees = 6.0;
+};
+
+// Streaming smoothing and resampling between pen input and the draft stroke.
+// Each raw sample goes through a One-Euro filter, then an arc-length
+// resampler whose spacing shrinks with curvature: straight runs keep few
+// points, tight turns keep many. Constant work per sample.
+class StrokeFilter {
+ public:
+  // Starts a stroke. `worldPerPixel` converts the pixel thresholds to world
+  // units at the current zoom.
+  void reset(const StrokeFilterOptions& opts, double worldPerPixel);
+
+  // Feeds one raw sample. Returns true and fills `out` if a point should be
+  // stored.
+  bool push(const StrokePoint& raw, StrokePoint* out);
+  // Pen up: returns the newest filtered sample if it wasn't stored, so the
+  // stroke doesn't stop short of the last movement.
+  bool finish(StrokePoint* out);
+
+ private:
+  struct LowPass {
+    double y = 0.0;
+    bool primed = false;
+    double filter(double x, double alpha) {
+      y = primed ? y + alpha * (x - y) : x;
+      primed = true;
+      return y;
+    }
+  };
+
+  static double alpha(double cutoffHz, double dtSec);
+  bool accept(const StrokePoint& p) const;
+
+  StrokeFilterOptions opts_;
+  double worldPerPixel_ = 1.0;
+
+  LowPass x_, y_, dx_, dy_, pressure_;
+  qint64 lastT_ = 0;
+  bool haveSample_ = false;
+
+  StrokePoint lastEmitted_;
+  QPointF lastDir_;  // unit direction of the last stored segment
+  bool haveEmitted_ = false;
+  StrokePoint latest_;  // newest filtered sample
+  bool latestStored_ = false;
+};
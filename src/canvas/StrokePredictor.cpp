@@ -0,0 +1,100 @@
+#include "StrokePredictor.h"
+
+#include <QLineF>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Least-squares fit of v(t) = c0 + c1 t + c2 t^2. Returns false if the
+// normal equations are degenerate.
+bool fitQuadratic(const double* t, const double* v, int n, double c[3]) {
+  double s[5] = {0, 0, 0, 0, 0};
+  double r[3] = {0, 0, 0};
+  for (int i = 0; i < n; ++i) {
+    double tk = 1.0;
+    for (int k = 0; k < 5; ++k) {
+      s[k] += tk;
+      if (k < 3) r[k] += tk * v[i];
+      tk *= t[i];
+    }
+  }
+  // Cramer's rule on the 3x3 system [s0 s1 s2; s1 s2 s3; s2 s3 s4] c = r.
+  const double det = s[0] * (s[2] * s[4] - s[3] * s[3]) - s[1] * (s[1] * s[4] - s[3] * s[2]) +
+                     s[2] * (s[1] * s[3] - s[2] * s[2]);
+  if (std::abs(det) < 1e-9) return false;
+  c[0] = (r[0] * (s[2] * s[4] - s[3] * s[3]) - s[1] * (r[1] * s[4] - s[3] * r[2]) +
+          s[2] * (r[1] * s[3] - s[2] * r[2])) / det;
+  c[1] = (s[0] * (r[1] * s[4] - s[3] * r[2]) - r[0] * (s[1] * s[4] - s[3] * s[2]) +
+          s[2] * (s[1] * r[2] - r[1] * s[2])) / det;
+  c[2] = (s[0] * (s[2] * r[2] - r[1] * s[3]) - s[1] * (s[1] * r[2] - r[1] * s[2]) +
+          r[0] * (s[1] * s[3] - s[2] * s[2])) / det;
+  return true;
+}
+
+}  // namespace
+
+QVector<QPointF> StrokePredictor::predict(const StrokePoints& pts, const StrokePredictionOptions& opts,
+                                          double* leadMs) {
+  QVector<QPointF> out;
+  if (leadMs) *leadMs = 0.0;
+  const qsizetype n = pts.size();
+  if (!opts.enabled || opts.horizonMs <= 0 || opts.steps <= 0 || n < 2) return out;
+
+  // Newest samples within the window, with time relative to the last one.
+  constexpr int kMaxFit = 32;
+  const int maxSamples = std::clamp(opts.maxSamples, 2, kMaxFit);
+  const qint64 tLast = pts.tMs(n - 1);
+  const QPointF last = pts.pos(n - 1);
+  double t[kMaxFit], x[kMaxFit], y[kMaxFit];
+  int m = 0;
+  for (qsizetype i = n - 1; i >= 0 && m < maxSamples; --i) {
+    const double dt = static_cast<double>(pts.tMs(i) - tLast);
+    if (-dt > opts.windowMs) break;
+    const QPointF p = pts.pos(i) - last;
+    t[m] = dt;
+    x[m] = p.x();
+    y[m] = p.y();
+    ++m;
+  }
+  if (m < 2) return out;
+  const double span = -t[m - 1];
+  if (span < 1.0) return out;
+
+  // Distance covered over the window bounds how far ahead we may draw.
+  const double travelled = std::hypot(x[m - 1], y[m - 1]);
+  const double maxLead = 1.5 * travelled * (opts.horizonMs / span);
+  if (maxLead < 0.5) return out;
+
+  double cx[3] = {0, x[m - 1] / -span, 0};
+  double cy[3] = {0, y[m - 1] / -span, 0};
+  if (m >= 4) {
+    double qx[3], qy[3];
+    if (fitQuadratic(t, x, m, qx) && fitQuadratic(t, y, m, qy)) {
+      std::copy(qx, qx + 3, cx);
+      std::copy(qy, qy + 3, cy);
+      // The fit needn't pass through the last sample; anchor it there.
+      cx[0] = cy[0] = 0;
+    }
+  }
+
+  out.reserve(opts.steps);
+  double lead = 0.0;
+  for (int k = 1; k <= opts.steps; ++k) {
+    const double h = opts.horizonMs * k / opts.steps;
+    QPointF d(cx[0] + cx[1] * h + cx[2] * h * h, cy[0] + cy[1] * h + cy[2] * h * h);
+    const double len = std::hypot(d.x(), d.y());
+    // A capped point stands for the time the pen would take to get there
+    // at the extrapolated speed.
+    double reachedMs = h;
+    if (len > maxLead) {
+      d *= maxLead / len;
+      reachedMs = h * maxLead / len;
+    }
+    lead = std::max(lead, reachedMs);
+    out.push_back(last + d);
+  }
+  if (leadMs) *leadMs = lead;
+  return out;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QPointF>
+#include <QVector>
+
+#include "model/StrokePoints.h"
+
+struct StrokePredictionOptions {
+  bool enabled = true;
+  // How far past the newest sample to extrapolate.
+  double horizonMs = 16.0;
+  // Samples older than this (relative to the newest) are ignored by the fit.
+  double windowMs = 60.0;
+  int maxSamples = 8;
+  // Points returned along the predicted segment.
+  int steps = 4;
+};
+
+// Extrapolates the pen tip from the newest samples of a live stroke so the
+// canvas can draw a short segment ahead of the real ink. Fits a quadratic
+// in time per axis (linear with fewer than four samples) and evaluates it
+// up to `horizonMs` past the last sample. The lead is capped by the recent
+// pen speed so a bad fit can't fling the segment away.
+class StrokePredictor {
+ public:
+  // Predicted points after the last sample, nearest first; empty when there
+  // is too little motion to extrapolate from. `leadMs` receives how far past
+  // the last sample the furthest point reaches in time: the horizon, less
+  // whatever the speed cap pulled in (0 when nothing is predicted).
+  static QVector<QPointF> predict(const StrokePoints& pts, const StrokePredictionOptions& opts,
+                                  double* leadMs = nullptr);
+};
@@ -0,0 +1,177 @@
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QMutex>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "export/PdfExporter.h"
+#include "export/RasterExporter.h"
+#include "export/SvgExporter.h"
+#include "model/Document.h"
+#include "storage/SqliteStore.h"
+#include "storage/TextSearch.h"
+#include "trace/Trace.h"
+
+namespace {
+
+struct Job {
+  QString input;
+  QString output;
+};
+
+struct JobResult {
+  bool ok = false;
+  qint64 loadMs = 0;
+  qint64 exportMs = 0;
+  QString error;
+  QString stats;  // -f stats
+};
+
+QString outputPathFor(const QString& input, const QString& outDir, const QString& format) {
+  const QFileInfo fi(input);
+  const QString name = fi.completeBaseName() + (format == "tiles" ? QString("_tiles") : "." + format);
+  return outDir.isEmpty() ? fi.dir().filePath(name) : QDir(outDir).filePath(name);
+}
+
+// Prints text box hits in files and directories, best first per argument.
+int runSearch(const QStringList& inputs, const QString& query) {
+  QTextStream out(stdout);
+  int hitCount = 0;
+  QElapsedTimer t;
+  t.start();
+  for (const auto& in : inputs) {
+    QString err;
+    const QVector<TextSearchHit> hits =
+        QFileInfo(in).isDir() ? TextSearch::searchDirectory(in, query) : TextSearch::searchFile(in, query, &err);
+    if (!err.isEmpty()) QTextStream(stderr) << in << ": " << err << Qt::endl;
+    for (const auto& h : hits) {
+      out << h.path << "  #" << h.textBoxId << "  (" << h.rect.x() << ", " << h.rect.y() << ")  "
+          << QString(h.snippet).replace('\n', ' ') << Qt::endl;
+    }
+    hitCount += int(hits.size());
+  }
+  out << hitCount << " hit(s) in " << t.elapsed() << " ms" << Qt::endl;
+  return hitCount > 0 ? 0 : 3;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // Batch export runs on servers without a display.
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QGuiApplication app(argc, argv);
+  QGuiApplication::setApplicationName("vellum-cli");
+  QGuiApplication::setOrganizationName("Vellum");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Convert .vellum notes to PDF, SVG or PNG tile directories, or search their text.");
+  parser.addHelpOption();
+  QCommandLineOption outDirOpt({"o", "output-dir"}, "Write output to <dir> instead of next to each input.", "dir");
+  QCommandLineOption formatOpt({"f", "format"},
+                               "Output format: pdf, svg, or tiles (PNG tiles of the whole canvas); stats prints "
+                               "content counts and memory use instead of exporting.",
+                               "format", "pdf");
+  QCommandLineOption dpiOpt("dpi", "Resolution of PNG tiles.", "dpi", "150");
+  QCommandLineOption jobsOpt({"j", "jobs"}, "Number of files converted in parallel.", "n",
+                             QString::number(QThread::idealThreadCount()));
+  QCommandLineOption traceOpt("trace", "Record load/export spans and write them as Chrome trace JSON to <file>.",
+                              "file");
+  parser.addOption(outDirOpt);
+  parser.addOption(jobsOpt);
+  parser.addOption(formatOpt);
+  parser.addOption(dpiOpt);
+  QCommandLineOption searchOpt("search", "Search text boxes in the given files and directories instead of converting.",
+                               "words");
+  parser.addOption(traceOpt);
+  parser.addOption(searchOpt);
+  parser.addPositionalArgument("files", "Input .vellum files (or directories with --search).", "<files...>");
+  parser.process(app);
+
+  const QStringList inputs = parser.positionalArguments();
+  if (inputs.isEmpty()) parser.showHelp(1);
+  if (parser.isSet(searchOpt)) return runSearch(inputs, parser.value(searchOpt));
+
+  const QString format = parser.value(formatOpt);
+  if (format != "pdf" && format != "svg" && format != "tiles" && format != "stats") {
+    QTextStream(stderr) << "Unknown format " << format << "\n";
+    return 1;
+  }
+  RasterExportOptions rasterOpts;
+  rasterOpts.dpi = parser.value(dpiOpt).toDouble();
+
+  const QString outDir = parser.value(outDirOpt);
+  if (!outDir.isEmpty() && !QDir().mkpath(outDir)) {
+    QTextStream(stderr) << "Cannot create output directory " << outDir << "\n";
+    return 1;
+  }
+
+  QString tracePath = Tracer::startFromEnvironment();
+  if (parser.isSet(traceOpt)) {
+    tracePath = parser.value(traceOpt);
+    Tracer::setEnabled(true);
+  }
+
+  QVector<Job> jobs;
+  jobs.reserve(inputs.size());
+  for (const auto& in : inputs) jobs.push_back(Job{in, outputPathFor(in, outDir, format)});
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(std::max(1, parser.value(jobsOpt).toInt()));
+
+  QMutex outMutex;
+  QTextStream out(stdout);
+  int failures = 0;
+
+  // Each job owns its Document, so workers share nothing but the output.
+  auto run = [&](const Job& job) {
+    VELLUM_TRACE_SCOPE("cli", "convert file");
+    JobResult r;
+    QElapsedTimer t;
+    t.start();
+
+    Document doc;
+    r.ok = SqliteStore::loadFromFile(job.input, &doc, &r.error);
+    r.loadMs = t.restart();
+    if (r.ok) {
+      if (format == "stats") {
+        r.stats = doc.stats().describe();
+      } else if (format == "tiles") {
+        r.ok = RasterExporter::exportTiles(job.output, doc, &r.error, rasterOpts);
+      } else if (format == "svg") {
+        r.ok = SvgExporter::exportToSvg(job.output, doc, &r.error);
+      } else {
+        r.ok = PdfExporter::exportToPdf(job.output, doc, QRectF(), &r.error);
+      }
+      r.exportMs = t.elapsed();
+    }
+
+    QMutexLocker lock(&outMutex);
+    if (r.ok && format == "stats") {
+      out << job.input << "\n" << r.stats << Qt::endl;
+    } else if (r.ok) {
+      out << "ok    load " << r.loadMs << " ms  export " << r.exportMs << " ms  " << job.input << " -> "
+          << job.output << Qt::endl;
+    } else {
+      ++failures;
+      out << "FAIL  " << job.input << ": " << r.error << Qt::endl;
+    }
+  };
+
+  QElapsedTimer wall;
+  wall.start();
+  QtConcurrent::blockingMap(&pool, jobs, run);
+
+  out << jobs.size() << " file(s), " << failures << " failed, " << wall.elapsed() << " ms total" << Qt::endl;
+
+  if (!tracePath.isEmpty()) {
+    QString err;
+    if (!Tracer::writeChromeTrace(tracePath, &err)) QTextStream(stderr) << "Cannot write trace: " << err << "\n";
+  }
+  return failures == 0 ? 0 : 2;
+}
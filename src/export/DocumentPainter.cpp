@@ -0,0 +1,172 @@
+#include "DocumentPainter.h"
+
+#include <QtMath>
+#include <QDataStream>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPen>
+#include <QTextDocument>
+
+#include "model/Document.h"
+
+namespace {
+constexpr int kCapSegments = 8;
+constexpr float kConstantPressureEps = 1e-3f;
+}  // namespace
+
+QRectF DocumentPainter::contentBounds(const Document& doc) {
+  QRectF b;
+  bool has = false;
+
+  for (const auto& s : doc.strokes()) {
+    if (s.pts.isEmpty()) continue;
+    const QRectF sb = s.bounds();
+    b = has ? (b | sb) : sb;
+    has = true;
+  }
+  for (const auto& t : doc.textBoxes()) {
+    b = has ? (b | t.rectWorld) : t.rectWorld;
+    has = true;
+  }
+  if (!has) return QRectF(0, 0, 1, 1);
+  return b;
+}
+
+void DocumentPainter::drawStroke(QPainter& p, const Stroke& s) {
+  if (s.pts.size() < 2) return;
+
+  QPen pen;
+  pen.setColor(s.color);
+  pen.setCapStyle(Qt::RoundCap);
+  pen.setJoinStyle(Qt::RoundJoin);
+
+  if (s.isShape && !s.shapeType.isEmpty()) {
+    float avg = 0.0f;
+    for (const auto& pt : s.pts) avg += pt.pressure;
+    // Cast 1 to double to match s.pts.size() type
+    avg /= std::max(1.0, static_cast<double>(s.pts.size()));
+    pen.setWidthF(std::max(0.5, s.baseWidthPoints * static_cast<double>(avg)));
+    p.setPen(pen);
+
+    if (s.shapeType == "line") {
+      QDataStream ds(s.shapeParams);
+      ds.setVersion(QDataStream::Qt_6_0);
+      QPointF a, b;
+      ds >> a >> b;
+      p.drawLine(a, b);
+      return;
+    }
+    if (s.shapeType == "circle") {
+      QDataStream ds(s.shapeParams);
+      ds.setVersion(QDataStream::Qt_6_0);
+      QPointF c;
+      double r = 0;
+      ds >> c >> r;
+      p.drawEllipse(QRectF(c.x() - r, c.y() - r, 2 * r, 2 * r));
+      return;
+    }
+    if (s.shapeType == "rect") {
+      QDataStream ds(s.shapeParams);
+      ds.setVersion(QDataStream::Qt_6_0);
+      QRectF r;
+      ds >> r;
+      p.drawRect(r);
+      return;
+    }
+  }
+
+  for (int i = 1; i < s.pts.size(); ++i) {
+    const float pr = (s.pts.pressure(i - 1) + s.pts.pressure(i)) * 0.5f;
+    pen.setWidthF(std::max(0.5, s.baseWidthPoints * static_cast<double>(pr)));
+    p.setPen(pen);
+    p.drawLine(s.pts.pos(i - 1), s.pts.pos(i));
+  }
+}
+
+bool DocumentPainter::hasConstantPressure(const Stroke& s) {
+  const float p0 = s.pts.pressure(0);
+  for (qsizetype i = 1; i < s.pts.size(); ++i) {
+    if (std::abs(s.pts.pressure(i) - p0) > kConstantPressureEps) return false;
+  }
+  return true;
+}
+
+QPainterPath DocumentPainter::shapePath(const Stroke& s) {
+  QPainterPath path;
+  QDataStream ds(s.shapeParams);
+  ds.setVersion(QDataStream::Qt_6_0);
+  if (s.shapeType == "line") {
+    QPointF a, b;
+    ds >> a >> b;
+    path.moveTo(a);
+    path.lineTo(b);
+  } else if (s.shapeType == "circle") {
+    QPointF c;
+    double r = 0;
+    ds >> c >> r;
+    path.addEllipse(QRectF(c.x() - r, c.y() - r, 2 * r, 2 * r));
+  } else if (s.shapeType == "rect") {
+    QRectF r;
+    ds >> r;
+    path.addRect(r);
+  }
+  if (ds.status() != QDataStream::Ok) return QPainterPath();
+  return path;
+}
+
+// Single closed contour (left side forward, end cap, right side backward,
+// start cap) so WindingFill never punches holes where the stroke crosses
+// itself.
+void DocumentPainter::appendOutline(QPainterPath& path, const Stroke& s) {
+  const int n = s.pts.size();
+  QVector<QPointF> left;
+  QVector<QPointF> right;
+  left.reserve(n);
+  right.reserve(n);
+
+  QPointF normal(0, 1);
+  QPointF firstDir(1, 0);
+  QPointF lastDir(1, 0);
+  for (int i = 0; i < n; ++i) {
+    const QPointF d = s.pts.pos(std::min(n - 1, i + 1)) - s.pts.pos(std::max(0, i - 1));
+    const double len = std::hypot(d.x(), d.y());
+    if (len > 1e-9) {
+      normal = QPointF(-d.y() / len, d.x() / len);
+      if (i == 0) firstDir = d / len;
+      lastDir = d / len;
+    }
+    const double hw = 0.5 * std::max(0.5, s.baseWidthPoints * static_cast<double>(s.pts.pressure(i)));
+    left.push_back(s.pts.pos(i) + normal * hw);
+    right.push_back(s.pts.pos(i) - normal * hw);
+  }
+
+  auto cap = [&](QPolygonF& poly, const QPointF& c, const QPointF& dir, double hw, double sign) {
+    const QPointF nrm(-dir.y(), dir.x());
+    for (int k = 1; k < kCapSegments; ++k) {
+      const double a = M_PI * k / kCapSegments;
+      poly << c + sign * (nrm * (hw * std::cos(a)) + dir * (hw * std::sin(a)));
+    }
+  };
+  const double hwFirst = 0.5 * std::max(0.5, s.baseWidthPoints * static_cast<double>(s.pts.front().pressure));
+  const double hwLast = 0.5 * std::max(0.5, s.baseWidthPoints * static_cast<double>(s.pts.back().pressure));
+
+  QPolygonF poly;
+  poly.reserve(2 * n + 2 * kCapSegments);
+  for (const auto& pt : left) poly << pt;
+  cap(poly, s.pts.back().worldPos, lastDir, hwLast, 1.0);
+  for (int i = n - 1; i >= 0; --i) poly << right[i];
+  cap(poly, s.pts.front().worldPos, firstDir, hwFirst, -1.0);
+  path.addPolygon(poly);
+  path.closeSubpath();
+}
+
+void DocumentPainter::drawTextBox(QPainter& p, const TextBox& tb) {
+  QTextDocument doc;
+  doc.setMarkdown(tb.markdown);
+  doc.setTextWidth(std::max(1.0, tb.rectWorld.width() - 10.0));
+
+  p.save();
+  p.translate(tb.rectWorld.topLeft() + QPointF(5, 4));
+  doc.drawContents(&p);
+  p.restore();
+}
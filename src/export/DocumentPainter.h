@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QPainterPath>
+#include <QRectF>
+
+#include "model/Stroke.h"
+#include "model/TextBox.h"
+
+class Document;
+class QPainter;
+
+// World-space drawing shared by the exporters. The painter's transform maps
+// world coordinates (points) to the target device.
+class DocumentPainter {
+ public:
+  // Union of stroke and text box bounds; (0,0,1,1) for an empty document.
+  static QRectF contentBounds(const Document& doc);
+
+  static void drawStroke(QPainter& p, const Stroke& s);
+  static void drawTextBox(QPainter& p, const TextBox& tb);
+
+  // Perfect shape of a recognized stroke, empty if the params don't decode.
+  static QPainterPath shapePath(const Stroke& s);
+  static bool hasConstantPressure(const Stroke& s);
+  // Appends the variable-width outline of `s` (round caps) as one closed
+  // subpath, to be filled with Qt::WindingFill.
+  static void appendOutline(QPainterPath& path, const Stroke& s);
+};
@@ -1,107 +1,117 @@
 #include "PdfExporter.h"
 
 #include <QtMath>
-#include <QDataStream>
 #include <QFile>
 #include <QPainter>
+#include <QPainterPath>
 #include <QPdfWriter>
-#include <QTextDocument>
 #include <QPageSize>
 #include <QPen>
+#include <QPicture>
+#include <QThreadPool>
+#include <QtConcurrent>
 
+#include <numeric>
+
+#include "export/DocumentPainter.h"
 #include "model/Document.h"
+#include "trace/Trace.h"
 
 namespace {
 constexpr double kA4W = 595.0;  // points
 constexpr double kA4H = 842.0;
 constexpr double kGap = 48.0;
 
-QRectF docContentBoundsWorld(const Document& doc) {
-  QRectF b;
-  bool has = false;
-
-  for (const auto& s : doc.strokes()) {
-    if (s.pts.isEmpty()) continue;
-    const QRectF sb = s.bounds();
-    b = has ? (b | sb) : sb;
-    has = true;
-  }
-  for (const auto& t : doc.textBoxes()) {
-    b = has ? (b | t.rectWorld) : t.rectWorld;
-    has = true;
-  }
-  if (!has) return QRectF(0, 0, 1, 1);
-  return b;
-}
-
-void drawStrokeWorld(QPainter& p, const Stroke& s) {
-  if (s.pts.size() < 2) return;
-
-  QPen pen;
-  pen.setColor(s.color);
-  pen.setCapStyle(Qt::RoundCap);
-  pen.setJoinStyle(Qt::RoundJoin);
-
-  if (s.isShape && !s.shapeType.isEmpty()) {
-    float avg = 0.0f;
-    for (const auto& pt : s.pts) avg += pt.pressure;
-    // Cast 1 to double to match s.pts.size() type
-    avg /= std::max(1.0, static_cast<double>(s.pts.size()));
-    pen.setWidthF(std::max(0.5, s.baseWidthPoints * static_cast<double>(avg)));
-    p.setPen(pen);
-
-    if (s.shapeType == "line") {
-      QDataStream ds(s.shapeParams);
-      ds.setVersion(QDataStream::Qt_6_0);
-      QPointF a, b;
-      ds >> a >> b;
-      p.drawLine(a, b);
-      return;
+// Collects consecutive strokes that share a paint state into one path, so
+// the PDF gets one path object and one state change per run instead of one
+// per segment. Constant-pressure strokes and shapes are stroked as
+// polylines; pressure-varying strokes are filled outlines.
+class StrokeBatch {
+ public:
+  explicit StrokeBatch(QPainter& p) : p_(p) {}
+  ~StrokeBatch() { flush(); }
+
+  void add(const Stroke& s) {
+    if (s.pts.size() < 2) return;
+
+    if (s.isShape && !s.shapeType.isEmpty()) {
+      const QPainterPath shape = DocumentPainter::shapePath(s);
+      if (!shape.isEmpty()) {
+        float avg = 0.0f;
+        for (const auto& pt : s.pts) avg += pt.pressure;
+        avg /= static_cast<float>(s.pts.size());
+        begin(Kind::Polyline, s.color, std::max(0.5, s.baseWidthPoints * static_cast<double>(avg)));
+        path_.addPath(shape);
+        return;
+      }
     }
-    if (s.shapeType == "circle") {
-      QDataStream ds(s.shapeParams);
-      ds.setVersion(QDataStream::Qt_6_0);
-      QPointF c;
-      double r = 0;
-      ds >> c >> r;
-      p.drawEllipse(QRectF(c.x() - r, c.y() - r, 2 * r, 2 * r));
+
+    if (DocumentPainter::hasConstantPressure(s)) {
+      begin(Kind::Polyline, s.color,
+            std::max(0.5, s.baseWidthPoints * static_cast<double>(s.pts.front().pressure)));
+      path_.moveTo(s.pts.front().worldPos);
+      for (int i = 1; i < s.pts.size(); ++i) path_.lineTo(s.pts.pos(i));
       return;
     }
-    if (s.shapeType == "rect") {
-      QDataStream ds(s.shapeParams);
-      ds.setVersion(QDataStream::Qt_6_0);
-      QRectF r;
-      ds >> r;
-      p.drawRect(r);
-      return;
+
+    begin(Kind::Outline, s.color, 0.0);
+    DocumentPainter::appendOutline(path_, s);
+  }
+
+  void flush() {
+    if (kind_ == Kind::Polyline) {
+      p_.strokePath(path_, QPen(color_, width_, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    } else if (kind_ == Kind::Outline) {
+      p_.fillPath(path_, color_);
     }
+    kind_ = Kind::None;
+    path_.clear();
   }
 
-  for (int i = 1; i < s.pts.size(); ++i) {
-    const auto& a = s.pts[i - 1];
-    const auto& b = s.pts[i];
-    const float pr = (a.pressure + b.pressure) * 0.5f;
-    pen.setWidthF(std::max(0.5, s.baseWidthPoints * static_cast<double>(pr)));
-    p.setPen(pen);
-    p.drawLine(a.worldPos, b.worldPos);
+ private:
+  enum class Kind { None, Polyline, Outline };
+
+  void begin(Kind kind, const QColor& color, double width) {
+    if (kind == kind_ && color == color_ && (kind == Kind::Outline || qFuzzyCompare(width, width_))) return;
+    flush();
+    kind_ = kind;
+    color_ = color;
+    width_ = width;
+    path_.setFillRule(Qt::WindingFill);
   }
-}
 
-void drawTextBoxWorld(QPainter& p, const TextBox& tb) {
-  QTextDocument doc;
-  doc.setMarkdown(tb.markdown);
-  doc.setTextWidth(std::max(1.0, tb.rectWorld.width() - 10.0));
+  QPainter& p_;
+  Kind kind_ = Kind::None;
+  QColor color_;
+  double width_ = 0.0;
+  QPainterPath path_;
+};
+
+void drawStrokeList(QPainter& p, const QVector<const Stroke*>& strokes, const PdfExportOptions& opts) {
+  if (!opts.mergeStrokePaths) {
+    for (const Stroke* s : strokes) DocumentPainter::drawStroke(p, *s);
+    return;
+  }
+  StrokeBatch batch(p);
+  for (const Stroke* s : strokes) batch.add(*s);
+}
 
-  p.save();
-  p.translate(tb.rectWorld.topLeft() + QPointF(5, 4));
-  doc.drawContents(&p);
-  p.restore();
+// Page range [first, last] a world rect touches, clamped to [0, lastPage];
+// false if it lies entirely outside the notebook.
+bool pageSpan(const QRectF& r, double stride, int lastPage, int* first, int* last) {
+  const int f = static_cast<int>(std::floor(r.top() / stride));
+  const int l = static_cast<int>(std::floor(r.bottom() / stride));
+  if (l < 0 || f > lastPage) return false;
+  *first = std::max(0, f);
+  *last = std::min(lastPage, l);
+  return true;
 }
 
 }  // namespace
 
 bool PdfExporter::exportToPdf(const QString& path, const Document& doc, const QRectF& viewportWorld,
-                             QString* err) {
+                             QString* err, const PdfExportOptions& opts) {
+  VELLUM_TRACE_SCOPE("export", "PdfExporter::exportToPdf");
   QPdfWriter writer(path);
   writer.setResolution(72);  // 1 unit == 1 point
   writer.setPageSize(QPageSize(QPageSize::A4));
@@ -114,23 +124,54 @@ bool PdfExporter::exportToPdf(const QString& path, const Document& doc, const QR
   p.setRenderHint(QPainter::Antialiasing, true);
 
   if (doc.viewMode() == Document::ViewMode::A4Notebook) {
-    const QRectF content = docContentBoundsWorld(doc);
+    const QRectF content = DocumentPainter::contentBounds(doc);
     const double stride = kA4H + kGap;
     const int lastPage = std::max(0, static_cast<int>(std::ceil(content.bottom() / stride)));
 
-    for (int page = 0; page <= lastPage; ++page) {
-      if (page != 0) writer.newPage();
-
-      p.save();
-      p.translate(0, -page * stride);
-
-      // White page background.
-      p.fillRect(QRectF(0, page * stride, kA4W, kA4H), Qt::white);
-
-      for (const auto& s : doc.strokes()) drawStrokeWorld(p, s);
-      for (const auto& t : doc.textBoxes()) drawTextBoxWorld(p, t);
+    // Bucket content by page once; each page then only draws what touches it.
+    QVector<QVector<const Stroke*>> pageStrokes(lastPage + 1);
+    QVector<QVector<const TextBox*>> pageTexts(lastPage + 1);
+    int first = 0;
+    int last = 0;
+    for (const auto& s : doc.strokes()) {
+      if (s.pts.size() < 2) continue;
+      const double pad = s.baseWidthPoints;
+      if (!pageSpan(s.bounds().adjusted(-pad, -pad, pad, pad), stride, lastPage, &first, &last)) continue;
+      for (int page = first; page <= last; ++page) pageStrokes[page].push_back(&s);
+    }
+    for (const auto& t : doc.textBoxes()) {
+      if (!pageSpan(t.rectWorld, stride, lastPage, &first, &last)) continue;
+      for (int page = first; page <= last; ++page) pageTexts[page].push_back(&t);
+    }
 
-      p.restore();
+    // Record pages in parallel, then replay them into the writer in order.
+    // Batches keep at most a couple of pages per worker alive at once.
+    auto recordPage = [&](int page) {
+      VELLUM_TRACE_SCOPE_ARG("export", "record page", page);
+      QPicture pic;
+      QPainter pp(&pic);
+      pp.setRenderHint(QPainter::Antialiasing, true);
+      pp.translate(0, -page * stride);
+      drawStrokeList(pp, pageStrokes[page], opts);
+      for (const TextBox* t : pageTexts[page]) DocumentPainter::drawTextBox(pp, *t);
+      pp.end();
+      return pic;
+    };
+
+    const int batchSize = std::max(1, QThreadPool::globalInstance()->maxThreadCount() * 2);
+    for (int batchStart = 0; batchStart <= lastPage; batchStart += batchSize) {
+      QVector<int> pages(std::min(batchSize, lastPage + 1 - batchStart));
+      std::iota(pages.begin(), pages.end(), batchStart);
+      const QVector<QPicture> pictures = QtConcurrent::blockingMapped<QVector<QPicture>>(pages, recordPage);
+
+      for (int i = 0; i < pictures.size(); ++i) {
+        VELLUM_TRACE_SCOPE_ARG("export", "write page", pages[i]);
+        if (pages[i] != 0) writer.newPage();
+
+        // White page background.
+        p.fillRect(QRectF(0, 0, kA4W, kA4H), Qt::white);
+        p.drawPicture(QPointF(0, 0), pictures[i]);
+      }
     }
 
     p.end();
@@ -138,7 +179,7 @@ bool PdfExporter::exportToPdf(const QString& path, const Document& doc, const QR
   }
 
   // Infinite mode: export current viewport to one page
-  const QRectF vp = viewportWorld.isValid() ? viewportWorld : docContentBoundsWorld(doc);
+  const QRectF vp = viewportWorld.isValid() ? viewportWorld : DocumentPainter::contentBounds(doc);
 
   const double margin = 24.0;
   const QRectF pageRect(margin, margin, kA4W - 2 * margin, kA4H - 2 * margin);
@@ -152,8 +193,11 @@ bool PdfExporter::exportToPdf(const QString& path, const Document& doc, const QR
   p.scale(s, s);
   p.translate(-vp.center());
 
-  for (const auto& s0 : doc.strokes()) drawStrokeWorld(p, s0);
-  for (const auto& t : doc.textBoxes()) drawTextBoxWorld(p, t);
+  QVector<const Stroke*> strokes;
+  strokes.reserve(doc.strokes().size());
+  for (const auto& s0 : doc.strokes()) strokes.push_back(&s0);
+  drawStrokeList(p, strokes, opts);
+  for (const auto& t : doc.textBoxes()) DocumentPainter::drawTextBox(p, t);
 
   p.restore();
   p.end();
@@ -4,8 +4,15 @@
 #include <QRectF> // Essential for QRectF to be recognized
 #include "model/Document.h"
 
+struct PdfExportOptions {
+  // One path per stroke (polyline, or filled outline when pressure varies)
+  // with same-colored runs grouped; off emits one line per segment.
+  bool mergeStrokePaths = true;
+};
+
 class PdfExporter {
  public:
   static bool exportToPdf(const QString& path, const Document& doc, 
-                          const QRectF& viewportWorld, QString* err = nullptr);
+                          const QRectF& viewportWorld, QString* err = nullptr,
+                          const PdfExportOptions& opts = PdfExportOptions());
 };
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "RasterExporter.h"
+
+#include <QtMath>
+#include <QDir>
+#include <QHash>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPolygonF>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+#include "export/DocumentPainter.h"
+
+namespace {
+
+constexpr double kA4W = 595.0;  // points
+constexpr double kA4H = 842.0;
+constexpr double kGap = 48.0;
+
+// Grids past this many cells (blank or not) are refused: tile indices and
+// file names stop being meaningful long before.
+constexpr qint64 kMaxGridCells = qint64(1) << 40;
+
+struct TileSpan {
+  qint64 c0 = 0, r0 = 0, c1 = -1, r1 = -1;
+};
+
+// Inclusive tile index range a world rect touches, clamped to the grid;
+// false if it lies entirely outside.
+bool tileSpan(const QRectF& r, const QPointF& origin, double tileWorld, qint64 cols, qint64 rows, TileSpan* out) {
+  const qint64 c0 = static_cast<qint64>(std::floor((r.left() - origin.x()) / tileWorld));
+  const qint64 c1 = static_cast<qint64>(std::floor((r.right() - origin.x()) / tileWorld));
+  const qint64 r0 = static_cast<qint64>(std::floor((r.top() - origin.y()) / tileWorld));
+  const qint64 r1 = static_cast<qint64>(std::floor((r.bottom() - origin.y()) / tileWorld));
+  if (c1 < 0 || r1 < 0 || c0 >= cols || r0 >= rows) return false;
+  *out = TileSpan{std::max<qint64>(0, c0), std::max<qint64>(0, r0), std::min(cols - 1, c1), std::min(rows - 1, r1)};
+  return true;
+}
+
+// Visits the key of every tile within `pad` of the polyline, possibly more
+// than once. Segments are walked in steps of at most half a tile, so a long
+// diagonal marks the tiles it crosses rather than its whole bounding box.
+template <typename Visit>
+void visitPolylineTiles(const QPolygonF& line, double pad, const QPointF& origin, double tileWorld, qint64 cols,
+                        qint64 rows, Visit visit) {
+  auto visitRect = [&](const QRectF& r) {
+    TileSpan span;
+    if (!tileSpan(r.adjusted(-pad, -pad, pad, pad), origin, tileWorld, cols, rows, &span)) return;
+    for (qint64 row = span.r0; row <= span.r1; ++row)
+      for (qint64 col = span.c0; col <= span.c1; ++col) visit(row * cols + col);
+  };
+  if (line.size() == 1) visitRect(QRectF(line[0], line[0]));
+  for (qsizetype i = 1; i < line.size(); ++i) {
+    const QPointF a = line[i - 1];
+    const QPointF d = line[i] - a;
+    const qint64 steps = std::max<qint64>(1, static_cast<qint64>(std::ceil(std::hypot(d.x(), d.y()) / (0.5 * tileWorld))));
+    for (qint64 k = 0; k < steps; ++k)
+      visitRect(QRectF(a + d * (double(k) / steps), a + d * (double(k + 1) / steps)).normalized());
+  }
+}
+
+// What one non-blank tile draws.
+struct TileContent {
+  QVector<const Stroke*> strokes;
+  QVector<const TextBox*> texts;
+};
+
+}  // namespace
+
+bool RasterExporter::exportTiles(const QString& dirPath, const Document& doc, QString* err,
+                                 const RasterExportOptions& opts) {
+  if (opts.dpi <= 0 || opts.tileSize <= 0) {
+    if (err) *err = "Invalid DPI or tile size";
+    return false;
+  }
+  QDir dir(dirPath);
+  if (!dir.mkpath(".")) {
+    if (err) *err = QString("Cannot create %1").arg(dirPath);
+    return false;
+  }
+
+  const double scale = opts.dpi / 72.0;  // world units are points
+  const QRectF content = DocumentPainter::contentBounds(doc).adjusted(-opts.margin, -opts.margin,
+                                                                      opts.margin, opts.margin);
+  const QPointF origin = content.topLeft();
+  const double tileWorld = opts.tileSize / scale;
+  const double colsF = std::ceil(std::ceil(content.width() * scale) / opts.tileSize);
+  const double rowsF = std::ceil(std::ceil(content.height() * scale) / opts.tileSize);
+  if (!(colsF * rowsF <= double(kMaxGridCells))) {
+    if (err) *err = QString("Canvas too large for %1 dpi tiles (%2 x %3)").arg(opts.dpi).arg(colsF).arg(rowsF);
+    return false;
+  }
+  const qint64 widthPx = static_cast<qint64>(std::ceil(content.width() * scale));
+  const qint64 heightPx = static_cast<qint64>(std::ceil(content.height() * scale));
+  const qint64 cols = (widthPx + opts.tileSize - 1) / opts.tileSize;
+  const qint64 rows = (heightPx + opts.tileSize - 1) / opts.tileSize;
+
+  // Bucket content by tile once, keyed by row * cols + col. Only tiles that
+  // something is drawn on get a bucket, so a sparse infinite canvas costs
+  // what its ink covers, not its extent; each tile then draws only its
+  // bucket.
+  // Strokes go by the path they actually draw (see visitPolylineTiles).
+  QHash<qint64, TileContent> tiles;
+  for (const auto& s : doc.strokes()) {
+    if (s.pts.size() < 2) continue;
+    QList<QPolygonF> lines;
+    if (s.isShape && !s.shapeType.isEmpty()) lines = DocumentPainter::shapePath(s).toSubpathPolygons();
+    if (lines.isEmpty()) {
+      QPolygonF line;
+      line.reserve(s.pts.size());
+      for (qsizetype i = 0; i < s.pts.size(); ++i) line << s.pts.pos(i);
+      lines << line;
+    }
+    for (const QPolygonF& line : lines) {
+      visitPolylineTiles(line, s.baseWidthPoints, origin, tileWorld, cols, rows, [&](qint64 key) {
+        // Only this stroke is being added, so a repeat visit finds it last.
+        QVector<const Stroke*>& bucket = tiles[key].strokes;
+        if (bucket.isEmpty() || bucket.back() != &s) bucket.push_back(&s);
+      });
+    }
+  }
+  TileSpan span;
+  for (const auto& t : doc.textBoxes()) {
+    if (!tileSpan(t.rectWorld, origin, tileWorld, cols, rows, &span)) continue;
+    for (qint64 r = span.r0; r <= span.r1; ++r)
+      for (qint64 c = span.c0; c <= span.c1; ++c) tiles[r * cols + c].texts.push_back(&t);
+  }
+
+  QVector<qint64> indices = tiles.keys();
+  std::sort(indices.begin(), indices.end());
+
+  QMutex errMutex;
+  QString firstError;
+  const QHash<qint64, TileContent>& buckets = tiles;
+  auto renderTile = [&](qint64 index) {
+    const qint64 row = index / cols;
+    const qint64 col = index % cols;
+    const int w = static_cast<int>(std::min<qint64>(opts.tileSize, widthPx - col * opts.tileSize));
+    const int h = static_cast<int>(std::min<qint64>(opts.tileSize, heightPx - row * opts.tileSize));
+    const TileContent& tile = *buckets.constFind(index);
+
+    QImage img(w, h, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::white);
+    {
+      QPainter p(&img);
+      p.setRenderHint(QPainter::Antialiasing, true);
+      p.scale(scale, scale);
+      // Tile origin in world units, so the translation stays small.
+      p.translate(-(origin + QPointF(col, row) * tileWorld));
+      for (const Stroke* s : tile.strokes) DocumentPainter::drawStroke(p, *s);
+      for (const TextBox* t : tile.texts) DocumentPainter::drawTextBox(p, *t);
+    }
+
+    QSaveFile f(dir.filePath(QString("tile_%1_%2.png").arg(row).arg(col)));
+    if (!f.open(QIODevice::WriteOnly) || !img.save(&f, "PNG") || !f.commit()) {
+      QMutexLocker lock(&errMutex);
+      if (firstError.isEmpty()) firstError = QString("Failed to write %1").arg(f.fileName());
+    }
+  };
+
+  QtConcurrent::blockingMap(indices, renderTile);
+
+  if (!firstError.isEmpty()) {
+    if (err) *err = firstError;
+    return false;
+  }
+
+  // Blank tiles aren't written; "tiles" lists the [row, col] of those that are.
+  QJsonArray written;
+  for (qint64 index : indices) written.append(QJsonArray{index / cols, index % cols});
+
+  QJsonObject manifest;
+  manifest["dpi"] = opts.dpi;
+  manifest["tile_size"] = opts.tileSize;
+  manifest["columns"] = cols;
+  manifest["rows"] = rows;
+  manifest["width_px"] = widthPx;
+  manifest["height_px"] = heightPx;
+  manifest["origin_world"] = QJsonArray{origin.x(), origin.y()};
+  manifest["tiles"] = written;
+
+  QSaveFile mf(dir.filePath("tiles.json"));
+  if (!mf.open(QIODevice::WriteOnly) || mf.write(QJsonDocument(manifest).toJson()) < 0 || !mf.commit()) {
+    if (err) *err = QString("Failed to write %1").arg(mf.fileName());
+    return false;
+  }
+  return true;
+}
+
+QVector<QImage> RasterExporter::renderPreviews(const Document& doc, const PreviewOptions& opts) {
+  QVector<QRectF> areas;
+  if (doc.viewMode() == Document::ViewMode::A4Notebook) {
+    const double stride = kA4H + kGap;
+    const QRectF content = DocumentPainter::contentBounds(doc);
+    const int lastPage = std::clamp(static_cast<int>(std::floor(content.bottom() / stride)), 0,
+                                    std::max(0, opts.maxPages - 1));
+    for (int page = 0; page <= lastPage; ++page) areas.push_back(QRectF(0, page * stride, kA4W, kA4H));
+  } else {
+    const double margin = 24.0;
+    areas.push_back(DocumentPainter::contentBounds(doc).adjusted(-margin, -margin, margin, margin));
+  }
+
+  QVector<QImage> previews;
+  previews.reserve(areas.size());
+  for (const QRectF& area : areas) {
+    const double scale = opts.maxSide / std::max(area.width(), area.height());
+    QImage img(std::max(1, qRound(area.width() * scale)), std::max(1, qRound(area.height() * scale)),
+               QImage::Format_RGB32);
+    img.fill(Qt::white);
+    {
+      QPainter p(&img);
+      p.setRenderHint(QPainter::Antialiasing, true);
+      p.scale(scale, scale);
+      p.translate(-area.topLeft());
+      const auto& strokes = doc.strokes();
+      const auto& bounds = doc.strokeBounds();
+      for (int i = 0; i < strokes.size(); ++i) {
+        if (strokes[i].pts.size() < 2 || !Document::inkBounds(strokes[i], bounds[i]).intersects(area)) continue;
+        DocumentPainter::drawStroke(p, strokes[i]);
+      }
+      for (const auto& t : doc.textBoxes()) {
+        if (t.rectWorld.intersects(area)) DocumentPainter::drawTextBox(p, t);
+      }
+    }
+    previews.push_back(std::move(img));
+  }
+  return previews;
+}
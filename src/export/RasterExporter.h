@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+#include <QVector>
+
+#include "model/Document.h"
+
+struct RasterExportOptions {
+  double dpi = 150.0;
+  int tileSize = 512;      // px, square tiles
+  double margin = 24.0;    // world units around the content bounds
+};
+
+struct PreviewOptions {
+  int maxSide = 256;   // px, longest edge of each preview
+  int maxPages = 32;   // A4 mode: previews past this page are skipped
+};
+
+class RasterExporter {
+ public:
+  // Renders the whole document into `dirPath` as tile_<row>_<col>.png plus a
+  // tiles.json manifest listing them. Blank tiles are skipped, and tiles are
+  // rendered in parallel and written as soon as they are done, so time and
+  // memory follow the inked area rather than the canvas extent.
+  static bool exportTiles(const QString& dirPath, const Document& doc, QString* err = nullptr,
+                          const RasterExportOptions& opts = RasterExportOptions());
+
+  // Small previews: one per A4 page up to the last one with content in
+  // notebook mode, a single overview of the content in infinite mode.
+  // Renders on the calling thread; safe to call from a worker.
+  static QVector<QImage> renderPreviews(const Document& doc, const PreviewOptions& opts = PreviewOptions());
+};
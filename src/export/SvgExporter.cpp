@@ -0,0 +1,263 @@
+#include "SvgExporter.h"
+
+#include <QtMath>
+#include <QDataStream>
+#include <QPainterPath>
+#include <QSaveFile>
+#include <QXmlStreamWriter>
+
+#include <algorithm>
+
+#include "export/DocumentPainter.h"
+
+namespace {
+
+// Coordinates are kept as integers in units of 10^-precision, and relative
+// moves are taken between rounded positions, so deltas never accumulate
+// rounding error.
+class Fixed {
+ public:
+  explicit Fixed(int precision) : precision_(std::clamp(precision, 0, 6)), scale_(std::pow(10.0, precision_)) {}
+
+  qint64 quantize(double v) const { return std::llround(v * scale_); }
+
+  QString format(qint64 q) const {
+    if (precision_ == 0) return QString::number(q);
+    const bool neg = q < 0;
+    const qint64 a = neg ? -q : q;
+    const qint64 div = static_cast<qint64>(scale_);
+    QString frac = QString::number(a % div).rightJustified(precision_, '0');
+    while (frac.endsWith('0')) frac.chop(1);
+    QString out = neg ? QStringLiteral("-") : QString();
+    if (a / div != 0 || frac.isEmpty()) out += QString::number(a / div);
+    if (!frac.isEmpty()) out += QChar('.') + frac;
+    return out;
+  }
+
+  QString number(double v) const { return format(quantize(v)); }
+
+ private:
+  int precision_;
+  double scale_;
+};
+
+// Builds a compact path "d" string: absolute first move, relative after that,
+// implicit repeated commands, separators only where a number needs one.
+class PathData {
+ public:
+  explicit PathData(const Fixed& fx) : fx_(fx) {}
+
+  void moveTo(const QPointF& p) { emitPoint('M', 'm', p); }
+  void lineTo(const QPointF& p) { emitPoint(0, 'l', p); }
+  void close() {
+    d_ += 'z';
+    lastCmd_ = 'z';
+    // After z the current point is the start of the closed subpath.
+    x_ = startX_;
+    y_ = startY_;
+  }
+  const QString& data() const { return d_; }
+
+ private:
+  void emitPoint(char absCmd, char relCmd, const QPointF& p) {
+    const qint64 x = fx_.quantize(p.x());
+    const qint64 y = fx_.quantize(p.y());
+    if (d_.isEmpty()) {
+      d_ += absCmd ? absCmd : 'M';
+      lastCmd_ = 'M';
+      appendNumber(fx_.format(x), true);
+      appendNumber(fx_.format(y), false);
+    } else {
+      if (lastCmd_ != relCmd) {
+        d_ += relCmd;
+        lastCmd_ = relCmd;
+        appendNumber(fx_.format(x - x_), true);
+      } else {
+        appendNumber(fx_.format(x - x_), false);
+      }
+      appendNumber(fx_.format(y - y_), false);
+    }
+    x_ = x;
+    y_ = y;
+    if (lastCmd_ == 'M' || lastCmd_ == 'm') {
+      startX_ = x;
+      startY_ = y;
+    }
+  }
+
+  void appendNumber(const QString& n, bool afterCommand) {
+    if (!afterCommand && !n.startsWith('-') && !(n.startsWith('.') && lastHadDot_)) d_ += ' ';
+    d_ += n;
+    lastHadDot_ = n.contains('.');
+  }
+
+  const Fixed& fx_;
+  QString d_;
+  char lastCmd_ = 0;
+  bool lastHadDot_ = false;
+  qint64 x_ = 0;
+  qint64 y_ = 0;
+  qint64 startX_ = 0;
+  qint64 startY_ = 0;
+};
+
+void writePaint(QXmlStreamWriter& xml, const QColor& c, bool fill, double width, const Fixed& fx) {
+  if (fill) {
+    xml.writeAttribute("fill", c.name());
+    if (c.alpha() < 255) xml.writeAttribute("fill-opacity", QString::number(c.alphaF(), 'g', 3));
+    xml.writeAttribute("stroke", "none");
+  } else {
+    xml.writeAttribute("stroke", c.name());
+    if (c.alpha() < 255) xml.writeAttribute("stroke-opacity", QString::number(c.alphaF(), 'g', 3));
+    xml.writeAttribute("stroke-width", fx.number(width));
+  }
+}
+
+// Native element for a recognized shape; false if the params don't decode.
+bool writeShape(QXmlStreamWriter& xml, const Stroke& s, const Fixed& fx) {
+  float avg = 0.0f;
+  for (const auto& pt : s.pts) avg += pt.pressure;
+  avg /= static_cast<float>(s.pts.size());
+  const double width = std::max(0.5, s.baseWidthPoints * static_cast<double>(avg));
+
+  QDataStream ds(s.shapeParams);
+  ds.setVersion(QDataStream::Qt_6_0);
+  if (s.shapeType == "line") {
+    QPointF a, b;
+    ds >> a >> b;
+    if (ds.status() != QDataStream::Ok) return false;
+    xml.writeEmptyElement("line");
+    xml.writeAttribute("x1", fx.number(a.x()));
+    xml.writeAttribute("y1", fx.number(a.y()));
+    xml.writeAttribute("x2", fx.number(b.x()));
+    xml.writeAttribute("y2", fx.number(b.y()));
+  } else if (s.shapeType == "circle") {
+    QPointF c;
+    double r = 0;
+    ds >> c >> r;
+    if (ds.status() != QDataStream::Ok) return false;
+    xml.writeEmptyElement("circle");
+    xml.writeAttribute("cx", fx.number(c.x()));
+    xml.writeAttribute("cy", fx.number(c.y()));
+    xml.writeAttribute("r", fx.number(r));
+  } else if (s.shapeType == "rect") {
+    QRectF r;
+    ds >> r;
+    if (ds.status() != QDataStream::Ok) return false;
+    xml.writeEmptyElement("rect");
+    xml.writeAttribute("x", fx.number(r.x()));
+    xml.writeAttribute("y", fx.number(r.y()));
+    xml.writeAttribute("width", fx.number(r.width()));
+    xml.writeAttribute("height", fx.number(r.height()));
+  } else {
+    return false;
+  }
+  writePaint(xml, s.color, false, width, fx);
+  return true;
+}
+
+void writeStroke(QXmlStreamWriter& xml, const Stroke& s, const Fixed& fx) {
+  if (s.pts.size() < 2) return;
+  if (s.isShape && !s.shapeType.isEmpty() && writeShape(xml, s, fx)) return;
+
+  PathData d(fx);
+  if (DocumentPainter::hasConstantPressure(s)) {
+    d.moveTo(s.pts.front().worldPos);
+    for (int i = 1; i < s.pts.size(); ++i) d.lineTo(s.pts.pos(i));
+    xml.writeEmptyElement("path");
+    xml.writeAttribute("d", d.data());
+    writePaint(xml, s.color, false,
+               std::max(0.5, s.baseWidthPoints * static_cast<double>(s.pts.front().pressure)), fx);
+    return;
+  }
+
+  // Pressure varies along the stroke: SVG has no variable stroke width, so
+  // emit the filled outline instead.
+  QPainterPath outline;
+  DocumentPainter::appendOutline(outline, s);
+  for (int i = 0; i < outline.elementCount(); ++i) {
+    const QPainterPath::Element e = outline.elementAt(i);
+    if (e.isMoveTo()) {
+      if (i != 0) d.close();
+      d.moveTo(QPointF(e.x, e.y));
+    } else {
+      d.lineTo(QPointF(e.x, e.y));
+    }
+  }
+  d.close();
+  xml.writeEmptyElement("path");
+  xml.writeAttribute("d", d.data());
+  writePaint(xml, s.color, true, 0.0, fx);
+}
+
+void writeTextBox(QXmlStreamWriter& xml, const TextBox& tb, const Fixed& fx) {
+  if (tb.markdown.isEmpty()) return;
+  const QString x = fx.number(tb.rectWorld.left() + 5);
+  xml.writeStartElement("text");
+  xml.writeAttribute("x", x);
+  xml.writeAttribute("y", fx.number(tb.rectWorld.top() + 4));
+  bool first = true;
+  for (const QString& line : tb.markdown.split('\n')) {
+    xml.writeStartElement("tspan");
+    xml.writeAttribute("x", x);
+    xml.writeAttribute("dy", first ? "1em" : "1.2em");
+    xml.writeCharacters(line);
+    xml.writeEndElement();
+    first = false;
+  }
+  xml.writeEndElement();
+}
+
+}  // namespace
+
+bool SvgExporter::exportToSvg(const QString& path, const Document& doc, QString* err,
+                              const SvgExportOptions& opts) {
+  QSaveFile f(path);
+  if (!f.open(QIODevice::WriteOnly)) {
+    if (err) *err = f.errorString();
+    return false;
+  }
+
+  const Fixed fx(opts.precision);
+  const QRectF vb = DocumentPainter::contentBounds(doc).adjusted(-opts.margin, -opts.margin,
+                                                                 opts.margin, opts.margin);
+
+  QXmlStreamWriter xml(&f);
+  xml.writeStartDocument();
+  xml.writeStartElement("svg");
+  xml.writeDefaultNamespace("http://www.w3.org/2000/svg");
+  xml.writeAttribute("viewBox", QString("%1 %2 %3 %4")
+                                    .arg(fx.number(vb.x()), fx.number(vb.y()), fx.number(vb.width()),
+                                         fx.number(vb.height())));
+  xml.writeAttribute("width", fx.number(vb.width()) + "pt");
+  xml.writeAttribute("height", fx.number(vb.height()) + "pt");
+
+  xml.writeEmptyElement("rect");
+  xml.writeAttribute("x", fx.number(vb.x()));
+  xml.writeAttribute("y", fx.number(vb.y()));
+  xml.writeAttribute("width", fx.number(vb.width()));
+  xml.writeAttribute("height", fx.number(vb.height()));
+  xml.writeAttribute("fill", "white");
+
+  xml.writeStartElement("g");
+  xml.writeAttribute("fill", "none");
+  xml.writeAttribute("stroke-linecap", "round");
+  xml.writeAttribute("stroke-linejoin", "round");
+  for (const auto& s : doc.strokes()) writeStroke(xml, s, fx);
+  xml.writeEndElement();
+
+  xml.writeStartElement("g");
+  xml.writeAttribute("font-family", "sans-serif");
+  xml.writeAttribute("font-size", "12");
+  for (const auto& t : doc.textBoxes()) writeTextBox(xml, t, fx);
+  xml.writeEndElement();
+
+  xml.writeEndElement();
+  xml.writeEndDocument();
+
+  if (xml.hasError() || !f.commit()) {
+    if (err) *err = f.errorString();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QString>
+
+#include "model/Document.h"
+
+struct SvgExportOptions {
+  int precision = 2;      // decimals kept for coordinates
+  double margin = 24.0;   // world units around the content bounds
+};
+
+class SvgExporter {
+ public:
+  // Streams the whole document to an SVG file: one element per stroke
+  // (native <line>/<circle>/<rect> for recognized shapes, a relative-coord
+  // <path> otherwise) and <text> for text boxes. Nothing beyond the element
+  // being written is held in memory.
+  static bool exportToSvg(const QString& path, const Document& doc, QString* err = nullptr,
+                          const SvgExportOptions& opts = SvgExportOptions());
+};
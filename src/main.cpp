@@ -1,10 +1,16 @@
 #include <QApplication>
+#include <QDebug>
 #include <QIcon>
 #include <QStyleFactory>
 
 #include "app/MainWindow.h"
+#include "trace/Trace.h"
 
 int main(int argc, char** argv) {
+  // The canvas batches pen samples per frame itself; let every sample through
+  // so strokes keep the device's full rate.
+  QApplication::setAttribute(Qt::AA_CompressHighFrequencyEvents, false);
+  QApplication::setAttribute(Qt::AA_CompressTabletEvents, false);
   QApplication app(argc, argv);
   QApplication::setApplicationName("Vellum");
   QApplication::setOrganizationName("Vellum");
@@ -13,8 +19,17 @@ int main(int argc, char** argv) {
   app.setStyle(QStyleFactory::create("Fusion"));
   app.setWindowIcon(QIcon::fromTheme("accessories-text-editor"));
 
+  // VELLUM_TRACE=<file> records spans for the whole session and writes
+  // them on exit (Shift+F3 on the canvas flushes them earlier).
+  const QString tracePath = Tracer::startFromEnvironment();
+
   MainWindow w;
   w.show();
-  return app.exec();
+  const int rc = app.exec();
+
+  QString err;
+  if (!tracePath.isEmpty() && !Tracer::writeChromeTrace(tracePath, &err))
+    qWarning().noquote() << "Cannot write trace:" << err;
+  return rc;
 }
 
@@ -1,5 +1,27 @@
 #include "Commands.h"
 
+#include <QDateTime>
+#include <QDebug>
+
+// Edits closer together than this merge into one undo entry.
+static constexpr qint64 kMergeWindowMs = 3000;
+// Merged text edits stop growing past this many inserted/removed chars.
+static constexpr int kMaxMergedTextEdit = 512;
+
+// Held strokes can be squeezed into a compressed blob while they sit in old
+// history; they are restored before going back into the document.
+static void packStrokePayload(Stroke& s, QByteArray& packed) {
+    if (!packed.isEmpty() || s.pts.isEmpty()) return;
+    packed = qCompress(packStrokePoints(s.pts));
+    s.pts = StrokePoints();
+}
+
+static void unpackStrokePayload(Stroke& s, QByteArray& packed) {
+    if (packed.isEmpty()) return;
+    s.pts = unpackStrokePoints(qUncompress(packed));
+    packed.clear();
+}
+
 // --- Stroke Commands ---
 
 AddStrokeCommand::AddStrokeCommand(Document* doc, Stroke stroke, int index)
@@ -7,25 +29,58 @@ AddStrokeCommand::AddStrokeCommand(Document* doc, Stroke stroke, int index)
     setText("Add stroke");
 }
 
-void AddStrokeCommand::redo() {
-    index_ = doc_->insertStroke(index_, stroke_);
+void AddStrokeCommand::redoEdit() {
+    unpackStrokePayload(stroke_, packedPts_);
+    index_ = doc_->insertStroke(index_, std::move(stroke_));
+    stroke_ = Stroke{};
 }
 
-void AddStrokeCommand::undo() {
+void AddStrokeCommand::undoEdit() {
     stroke_ = doc_->takeStrokeAt(index_);
 }
 
+qint64 AddStrokeCommand::byteSize() const {
+    return sizeof(*this) + stroke_.byteSize() + packedPts_.capacity();
+}
+
+DocumentCommand* AddStrokeCommand::relocate() {
+    auto* c = new AddStrokeCommand(doc_, std::move(stroke_), index_);
+    c->packedPts_ = std::move(packedPts_);
+    return c;
+}
+
+void AddStrokeCommand::compact() {
+    packStrokePayload(stroke_, packedPts_);
+}
+
 RemoveStrokeCommand::RemoveStrokeCommand(Document* doc, int index) 
     : doc_(doc), index_(index) {
     setText("Remove stroke");
 }
 
-void RemoveStrokeCommand::redo() {
+void RemoveStrokeCommand::redoEdit() {
     removed_ = doc_->takeStrokeAt(index_);
 }
 
-void RemoveStrokeCommand::undo() {
-    doc_->insertStroke(index_, removed_);
+void RemoveStrokeCommand::undoEdit() {
+    unpackStrokePayload(removed_, packedPts_);
+    doc_->insertStroke(index_, std::move(removed_));
+    removed_ = Stroke{};
+}
+
+qint64 RemoveStrokeCommand::byteSize() const {
+    return sizeof(*this) + removed_.byteSize() + packedPts_.capacity();
+}
+
+DocumentCommand* RemoveStrokeCommand::relocate() {
+    auto* c = new RemoveStrokeCommand(doc_, index_);
+    c->removed_ = std::move(removed_);
+    c->packedPts_ = std::move(packedPts_);
+    return c;
+}
+
+void RemoveStrokeCommand::compact() {
+    packStrokePayload(removed_, packedPts_);
 }
 
 SetStrokeShapeCommand::SetStrokeShapeCommand(Document* doc, qint64 id, bool isShape, const QString& type, const QByteArray& params)
@@ -42,16 +97,29 @@ SetStrokeShapeCommand::SetStrokeShapeCommand(Document* doc, qint64 id, bool isSh
     }
 }
 
-void SetStrokeShapeCommand::redo() {
+void SetStrokeShapeCommand::redoEdit() {
     // Corrected to use the existing member function name
     doc_->setStrokeShapeById(id_, isShapeAfter_, typeAfter_, paramsAfter_);
 }
 
-void SetStrokeShapeCommand::undo() {
+void SetStrokeShapeCommand::undoEdit() {
     // Corrected to use the existing member function name
     doc_->setStrokeShapeById(id_, isShapeBefore_, typeBefore_, paramsBefore_);
 }
 
+qint64 SetStrokeShapeCommand::byteSize() const {
+    return sizeof(*this) + (typeBefore_.capacity() + typeAfter_.capacity()) * qint64(sizeof(QChar)) +
+           paramsBefore_.capacity() + paramsAfter_.capacity();
+}
+
+DocumentCommand* SetStrokeShapeCommand::relocate() {
+    auto* c = new SetStrokeShapeCommand(doc_, id_, isShapeAfter_, typeAfter_, paramsAfter_);
+    c->isShapeBefore_ = isShapeBefore_;
+    c->typeBefore_ = std::move(typeBefore_);
+    c->paramsBefore_ = std::move(paramsBefore_);
+    return c;
+}
+
 // --- Text Box Commands ---
 
 AddTextBoxCommand::AddTextBoxCommand(Document* doc, TextBox box, int index)
@@ -59,49 +127,155 @@ AddTextBoxCommand::AddTextBoxCommand(Document* doc, TextBox box, int index)
     setText("Add text box");
 }
 
-void AddTextBoxCommand::redo() {
-    index_ = doc_->insertTextBox(index_, box_);
+void AddTextBoxCommand::redoEdit() {
+    index_ = doc_->insertTextBox(index_, std::move(box_));
+    box_ = TextBox{};
 }
 
-void AddTextBoxCommand::undo() {
+void AddTextBoxCommand::undoEdit() {
     box_ = doc_->takeTextBoxAt(index_);
 }
 
+qint64 AddTextBoxCommand::byteSize() const {
+    return sizeof(*this) + box_.markdown.capacity() * qint64(sizeof(QChar));
+}
+
+DocumentCommand* AddTextBoxCommand::relocate() {
+    return new AddTextBoxCommand(doc_, std::move(box_), index_);
+}
+
 SetTextBoxRectCommand::SetTextBoxRectCommand(Document* doc, qint64 id, QRectF before, QRectF after)
-    : doc_(doc), id_(id), before_(std::move(before)), after_(std::move(after)) {
+    : doc_(doc), id_(id), before_(std::move(before)), after_(std::move(after)),
+      timeMs_(QDateTime::currentMSecsSinceEpoch()) {
     setText("Move/resize text box");
 }
 
-void SetTextBoxRectCommand::redo() {
+void SetTextBoxRectCommand::redoEdit() {
     doc_->setTextBoxRectById(id_, after_);
 }
 
-void SetTextBoxRectCommand::undo() {
+void SetTextBoxRectCommand::undoEdit() {
     doc_->setTextBoxRectById(id_, before_);
 }
 
+bool SetTextBoxRectCommand::mergeWith(const QUndoCommand* other) {
+    const auto* next = static_cast<const SetTextBoxRectCommand*>(other);
+    if (next->isRestoring() || next->id_ != id_ || next->timeMs_ - timeMs_ > kMergeWindowMs) return false;
+    after_ = next->after_;
+    timeMs_ = next->timeMs_;
+    setObsolete(after_ == before_);
+    return true;
+}
+
+qint64 SetTextBoxRectCommand::byteSize() const {
+    return sizeof(*this);
+}
+
+DocumentCommand* SetTextBoxRectCommand::relocate() {
+    auto* c = new SetTextBoxRectCommand(doc_, id_, before_, after_);
+    c->timeMs_ = timeMs_;
+    return c;
+}
+
 RemoveTextBoxCommand::RemoveTextBoxCommand(Document* doc, int index) 
     : doc_(doc), index_(index) {
     setText("Remove text box");
 }
 
-void RemoveTextBoxCommand::redo() {
+void RemoveTextBoxCommand::redoEdit() {
     removed_ = doc_->takeTextBoxAt(index_);
 }
 
-void RemoveTextBoxCommand::undo() {
-    doc_->insertTextBox(index_, removed_);
+void RemoveTextBoxCommand::undoEdit() {
+    doc_->insertTextBox(index_, std::move(removed_));
+    removed_ = TextBox{};
 }
 
-SetTextBoxMarkdownCommand::SetTextBoxMarkdownCommand(Document* doc, qint64 id, QString before, QString after)
-    : doc_(doc), id_(id), before_(std::move(before)), after_(std::move(after)) {
+qint64 RemoveTextBoxCommand::byteSize() const {
+    return sizeof(*this) + removed_.markdown.capacity() * qint64(sizeof(QChar));
+}
+
+DocumentCommand* RemoveTextBoxCommand::relocate() {
+    auto* c = new RemoveTextBoxCommand(doc_, index_);
+    c->removed_ = std::move(removed_);
+    return c;
+}
+
+SetTextBoxMarkdownCommand::SetTextBoxMarkdownCommand(Document* doc, qint64 id, const QString& before, const QString& after)
+    : doc_(doc), id_(id), timeMs_(QDateTime::currentMSecsSinceEpoch()) {
     setText("Edit text");
+    setDiff(before, after);
 }
 
-void SetTextBoxMarkdownCommand::redo() {
-    doc_->setTextBoxMarkdownById(id_, after_);
+void SetTextBoxMarkdownCommand::setDiff(const QString& before, const QString& after) {
+    const int maxCommon = std::min(before.size(), after.size());
+    int prefix = 0;
+    while (prefix < maxCommon && before[prefix] == after[prefix]) ++prefix;
+    int suffix = 0;
+    while (suffix < maxCommon - prefix &&
+           before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) ++suffix;
+
+    pos_ = prefix;
+    removed_ = before.mid(prefix, before.size() - prefix - suffix);
+    inserted_ = after.mid(prefix, after.size() - prefix - suffix);
+    beforeLength_ = before.size();
 }
 
-void SetTextBoxMarkdownCommand::undo() {
-    doc_->setTextBoxMarkdownById(id_, before_);
-}
\ No newline at end of file
+void SetTextBoxMarkdownCommand::apply(const QString& from, const QString& to, int fromLength) {
+    const int idx = doc_->textBoxIndexById(id_);
+    if (idx < 0) return;
+    QString text = doc_->textBoxes()[idx].markdown;
+    if (text.size() != fromLength || QStringView(text).mid(pos_, from.size()) != from) {
+        const int toLength = fromLength - from.size() + to.size();
+        if (text.size() != toLength || QStringView(text).mid(pos_, to.size()) != to)
+            qWarning() << "Text edit of box" << id_ << "no longer matches its text; undo entry skipped";
+        return;
+    }
+    text.replace(pos_, from.size(), to);
+    doc_->setTextBoxMarkdownById(id_, text);
+}
+
+void SetTextBoxMarkdownCommand::redoEdit() {
+    // On push the canvas has usually synced the box already; apply() then
+    // finds it in the target state and leaves it be.
+    apply(removed_, inserted_, beforeLength_);
+}
+
+void SetTextBoxMarkdownCommand::undoEdit() {
+    apply(inserted_, removed_, beforeLength_ - removed_.size() + inserted_.size());
+}
+
+bool SetTextBoxMarkdownCommand::mergeWith(const QUndoCommand* other) {
+    const auto* next = static_cast<const SetTextBoxMarkdownCommand*>(other);
+    if (next->isRestoring() || next->id_ != id_ || next->timeMs_ - timeMs_ > kMergeWindowMs) return false;
+    if (removed_.size() + inserted_.size() > kMaxMergedTextEdit) return false;
+
+    // Both edits are applied at this point: rebuild the text before this
+    // command from the current one and diff the two ends again.
+    const int idx = doc_->textBoxIndexById(id_);
+    if (idx < 0) return false;
+    const QString after = doc_->textBoxes()[idx].markdown;
+    QString before = after;
+    before.replace(next->pos_, next->inserted_.size(), next->removed_);
+    before.replace(pos_, inserted_.size(), removed_);
+    if (before.size() != beforeLength_) return false;
+
+    setDiff(before, after);
+    timeMs_ = next->timeMs_;
+    setObsolete(removed_.isEmpty() && inserted_.isEmpty());
+    return true;
+}
+
+qint64 SetTextBoxMarkdownCommand::byteSize() const {
+    return sizeof(*this) + (removed_.capacity() + inserted_.capacity()) * qint64(sizeof(QChar));
+}
+
+DocumentCommand* SetTextBoxMarkdownCommand::relocate() {
+    auto* c = new SetTextBoxMarkdownCommand(doc_, id_, QString(), QString());
+    c->pos_ = pos_;
+    c->removed_ = std::move(removed_);
+    c->inserted_ = std::move(inserted_);
+    c->beforeLength_ = beforeLength_;
+    c->timeMs_ = timeMs_;
+    return c;
+}
@@ -6,37 +6,86 @@
 #include <QByteArray>
 #include "model/Document.h"
 
+// Base for all document commands: reports what the command keeps alive so
+// Document can hold the undo history to a memory budget.
+class DocumentCommand : public QUndoCommand {
+public:
+    using QUndoCommand::QUndoCommand;
+
+    void undo() final { if (!restoring_) undoEdit(); }
+    void redo() final { if (!restoring_) redoEdit(); }
+
+    // Bytes held by the command's payload in its current state.
+    virtual qint64 byteSize() const = 0;
+    // Losslessly shrinks the payload; called on the oldest entries first
+    // when the history is over budget.
+    virtual void compact() {}
+
+    // A new command of the same kind that takes over this one's state,
+    // payload included. Document rebuilds the stack from these when it has
+    // to drop entries off its ends.
+    virtual DocumentCommand* relocate() = 0;
+
+    // While set, undo()/redo() leave the document alone and the command
+    // doesn't merge: the stack is being rebuilt around the current state.
+    void setRestoring(bool on) { restoring_ = on; }
+    bool isRestoring() const { return restoring_; }
+
+protected:
+    virtual void undoEdit() = 0;
+    virtual void redoEdit() = 0;
+
+private:
+    bool restoring_ = false;
+};
+
+// QUndoCommand::id() values for commands that merge with their predecessor.
+enum CommandId {
+    TextBoxRectCommandId = 1,
+    TextBoxMarkdownCommandId,
+};
+
 // --- Stroke Commands ---
 
-class AddStrokeCommand : public QUndoCommand {
+class AddStrokeCommand : public DocumentCommand {
 public:
     AddStrokeCommand(Document* doc, Stroke stroke, int index = -1);
-    void undo() override;
-    void redo() override;
+    void undoEdit() override;
+    void redoEdit() override;
+    qint64 byteSize() const override;
+    DocumentCommand* relocate() override;
+    void compact() override;
 
 private:
     Document* doc_;
-    Stroke stroke_;
+    Stroke stroke_;       // empty while the stroke lives in the document
+    QByteArray packedPts_;
     int index_;
 };
 
-class RemoveStrokeCommand : public QUndoCommand {
+class RemoveStrokeCommand : public DocumentCommand {
 public:
     RemoveStrokeCommand(Document* doc, int index);
-    void undo() override;
-    void redo() override;
+    void undoEdit() override;
+    void redoEdit() override;
+    qint64 byteSize() const override;
+    DocumentCommand* relocate() override;
+    void compact() override;
 
 private:
     Document* doc_;
-    Stroke removed_;
+    Stroke removed_;      // empty while the stroke lives in the document
+    QByteArray packedPts_;
     int index_;
 };
 
-class SetStrokeShapeCommand : public QUndoCommand {
+class SetStrokeShapeCommand : public DocumentCommand {
 public:
     SetStrokeShapeCommand(Document* doc, qint64 id, bool isShape, const QString& type, const QByteArray& params);
-    void undo() override;
-    void redo() override;
+    void undoEdit() override;
+    void redoEdit() override;
+    qint64 byteSize() const override;
+    DocumentCommand* relocate() override;
 
 private:
     Document* doc_;
@@ -48,52 +97,79 @@ private:
 
 // --- Text Box Commands ---
 
-class AddTextBoxCommand : public QUndoCommand {
+class AddTextBoxCommand : public DocumentCommand {
 public:
     AddTextBoxCommand(Document* doc, TextBox box, int index = -1);
-    void undo() override;
-    void redo() override;
+    void undoEdit() override;
+    void redoEdit() override;
+    qint64 byteSize() const override;
+    DocumentCommand* relocate() override;
 
 private:
     Document* doc_;
-    TextBox box_;
+    TextBox box_;         // empty while the box lives in the document
     int index_;
 };
 
-class SetTextBoxRectCommand : public QUndoCommand {
+// Consecutive moves/resizes of the same box within a short window merge
+// into one entry.
+class SetTextBoxRectCommand : public DocumentCommand {
 public:
     SetTextBoxRectCommand(Document* doc, qint64 id, QRectF before, QRectF after);
-    void undo() override;
-    void redo() override;
+    void undoEdit() override;
+    void redoEdit() override;
+    int id() const override { return TextBoxRectCommandId; }
+    bool mergeWith(const QUndoCommand* other) override;
+    qint64 byteSize() const override;
+    DocumentCommand* relocate() override;
 
 private:
     Document* doc_;
     qint64 id_;
     QRectF before_;
     QRectF after_;
+    qint64 timeMs_;
 };
 
-class RemoveTextBoxCommand : public QUndoCommand {
+class RemoveTextBoxCommand : public DocumentCommand {
 public:
     RemoveTextBoxCommand(Document* doc, int index);
-    void undo() override;
-    void redo() override;
+    void undoEdit() override;
+    void redoEdit() override;
+    qint64 byteSize() const override;
+    DocumentCommand* relocate() override;
 
 private:
     Document* doc_;
-    TextBox removed_;
+    TextBox removed_;     // empty while the box lives in the document
     int index_;
 };
 
-class SetTextBoxMarkdownCommand : public QUndoCommand {
+// Stores the edit as a single replaced range instead of full before/after
+// copies. Consecutive edits of the same box merge while they come in quick
+// succession, so typing a note yields a few compact entries.
+class SetTextBoxMarkdownCommand : public DocumentCommand {
 public:
-    SetTextBoxMarkdownCommand(Document* doc, qint64 id, QString before, QString after);
-    void undo() override;
-    void redo() override;
+    SetTextBoxMarkdownCommand(Document* doc, qint64 id, const QString& before, const QString& after);
+    void undoEdit() override;
+    void redoEdit() override;
+    int id() const override { return TextBoxMarkdownCommandId; }
+    bool mergeWith(const QUndoCommand* other) override;
+    qint64 byteSize() const override;
+    DocumentCommand* relocate() override;
 
 private:
+    void setDiff(const QString& before, const QString& after);
+    // Replaces `from` by `to` at pos_ if the box text is in the matching
+    // state; a box already in the target state is left alone. Any other
+    // state means the history lost track of the box and is logged.
+    void apply(const QString& from, const QString& to, int fromLength);
+
     Document* doc_;
     qint64 id_;
-    QString before_;
-    QString after_;
-};
\ No newline at end of file
+    int pos_ = 0;
+    QString removed_;
+    QString inserted_;
+    int beforeLength_ = 0;
+    qint64 timeMs_;
+};
@@ -1,36 +1,157 @@
 #include "Document.h"
 
-Document::Document(QObject* parent) : QObject(parent) {
+#include <algorithm>
+
+#include "model/Commands.h"
+#include "trace/Trace.h"
+
+Document::Document(QObject* parent) : QObject(parent), undo_(this) {
   undo_.setUndoLimit(200);
+  connect(&undo_, &QUndoStack::indexChanged, this, &Document::enforceUndoBudget);
+}
+
+void Document::undo() {
+  emit aboutToUndoRedo();
+  undo_.undo();
+}
+
+void Document::redo() {
+  emit aboutToUndoRedo();
+  undo_.redo();
+}
+
+void Document::setUndoMemoryBudget(qint64 bytes) {
+  undoBudget_ = std::max<qint64>(0, bytes);
+  enforceUndoBudget();
+}
+
+static qint64 commandBytes(const QUndoCommand* cmd) {
+  qint64 bytes = 0;
+  if (const auto* dc = dynamic_cast<const DocumentCommand*>(cmd)) bytes += dc->byteSize();
+  for (int i = 0; i < cmd->childCount(); ++i) bytes += commandBytes(cmd->child(i));
+  return bytes;
+}
+
+// QUndoStack only hands out const commands; they are all created non-const
+// by us, so compacting through const_cast is fine.
+static void compactCommand(const QUndoCommand* cmd) {
+  if (const auto* dc = dynamic_cast<const DocumentCommand*>(cmd)) const_cast<DocumentCommand*>(dc)->compact();
+  for (int i = 0; i < cmd->childCount(); ++i) compactCommand(cmd->child(i));
+}
+
+qint64 Document::undoMemoryUsage() const {
+  qint64 bytes = 0;
+  for (int i = 0; i < undo_.count(); ++i) bytes += commandBytes(undo_.command(i));
+  return bytes;
+}
+
+void Document::enforceUndoBudget() {
+  if (rebuildingUndo_) return;
+  qint64 usage = undoMemoryUsage();
+  for (int i = 0; i < undo_.count() && usage > undoBudget_; ++i) {
+    const QUndoCommand* cmd = undo_.command(i);
+    const qint64 before = commandBytes(cmd);
+    compactCommand(cmd);
+    usage -= before - commandBytes(cmd);
+  }
+  if (usage <= undoBudget_) return;
+
+  // Compression wasn't enough: drop the oldest applied entries, then the
+  // redo entries furthest from the current state.
+  int first = 0;
+  int end = undo_.count();
+  while (first < undo_.index() && usage > undoBudget_) usage -= commandBytes(undo_.command(first++));
+  while (end > undo_.index() && usage > undoBudget_) usage -= commandBytes(undo_.command(--end));
+  rebuildUndoStack(first, end);
+  Q_ASSERT(undoMemoryUsage() <= undoBudget_);
+}
+
+// QUndoStack can't remove entries itself (its count limit aside), so
+// keeping [first, end) means rebuilding it: each kept command hands its
+// state to a fresh copy, the copies are pushed and the index walked back,
+// all without touching the document, which already is in the right state.
+void Document::rebuildUndoStack(int first, int end) {
+  for (int i = first; i < end; ++i) {
+    if (!dynamic_cast<const DocumentCommand*>(undo_.command(i))) return;
+  }
+  const int index = undo_.index() - first;
+  const int clean = undo_.cleanIndex() < first || undo_.cleanIndex() > end ? -1 : undo_.cleanIndex() - first;
+
+  QVector<DocumentCommand*> kept;
+  for (int i = first; i < end; ++i) {
+    auto* cmd = const_cast<DocumentCommand*>(static_cast<const DocumentCommand*>(undo_.command(i)));
+    DocumentCommand* copy = cmd->relocate();
+    copy->setText(cmd->text());
+    copy->setRestoring(true);
+    kept.push_back(copy);
+  }
+
+  rebuildingUndo_ = true;
+  undo_.clear();
+  for (DocumentCommand* cmd : kept) undo_.push(cmd);
+  if (clean >= 0) {
+    undo_.setIndex(clean);
+    undo_.setClean();
+  } else {
+    undo_.resetClean();
+  }
+  undo_.setIndex(index);
+  for (DocumentCommand* cmd : kept) cmd->setRestoring(false);
+  rebuildingUndo_ = false;
 }
 
 void Document::clear() {
+  VELLUM_TRACE_SCOPE("document", "Document::clear");
   undo_.clear();
   strokes_.clear();
+  strokeBounds_.clear();
+  points_.clear();
   textBoxes_.clear();
   nextStrokeId_ = 1;
   nextTextBoxId_ = 1;
-  emit changed();
+  emit documentReset();
+  notifyChanged();
 }
 
 void Document::setViewMode(ViewMode m) {
+  VELLUM_TRACE_SCOPE("document", "Document::setViewMode");
   if (viewMode_ == m) return;
   viewMode_ = m;
   emit viewModeChanged(viewMode_);
-  emit changed();
+  notifyChanged();
+}
+
+void Document::compactPoints() {
+  VELLUM_TRACE_SCOPE("document", "Document::compactPoints");
+  PointArena packed;
+  for (Stroke& s : strokes_) s.pts = packed.intern(s.pts);
+  points_ = std::move(packed);
 }
 
 int Document::insertStroke(int index, Stroke s) {
+  VELLUM_TRACE_SCOPE("document", "Document::insertStroke");
   if (index < 0 || index > strokes_.size()) index = strokes_.size();
+  strokeBounds_.insert(index, s.bounds());
   strokes_.insert(index, std::move(s));
-  emit changed();
+  const Stroke& added = strokes_[index];
+  emit strokeAdded(added.id, index, inkBounds(added, strokeBounds_[index]));
+  notifyChanged();
   return index;
 }
 
 Stroke Document::takeStrokeAt(int index) {
+  VELLUM_TRACE_SCOPE("document", "Document::takeStrokeAt");
   if (index < 0 || index >= strokes_.size()) return Stroke{};
   Stroke s = strokes_.takeAt(index);
-  emit changed();
+  const QRectF ink = inkBounds(s, strokeBounds_.takeAt(index));
+  if (s.pts.isSpan()) {
+    // The span would dangle after the next compaction.
+    s.pts.detach();
+    points_.release(s.pts.size());
+    if (points_.wantsCompaction()) compactPoints();
+  }
+  emit strokeRemoved(s.id, index, ink);
+  notifyChanged();
   return s;
 }
 
@@ -43,25 +164,43 @@ int Document::strokeIndexById(qint64 id) const {
 
 void Document::setStrokeShapeById(qint64 id, bool isShape, const QString& type,
                                 const QByteArray& params) {
+  VELLUM_TRACE_SCOPE("document", "Document::setStrokeShapeById");
   const int idx = strokeIndexById(id);
   if (idx < 0) return;
-  strokes_[idx].isShape = isShape;
-  strokes_[idx].shapeType = type;
-  strokes_[idx].shapeParams = params;
-  emit changed();
+  Stroke& s = strokes_[idx];
+  const QRectF oldInk = inkBounds(s, strokeBounds_[idx]);
+  s.isShape = isShape;
+  s.shapeType = type;
+  s.shapeParams = params;
+  // Rendering only needs shapeParams; keep the raw samples packed until the
+  // recognition is undone.
+  const qsizetype before = s.pts.isSpan() ? s.pts.size() : 0;
+  if (isShape && !type.isEmpty()) {
+    s.packRawPoints();
+  } else {
+    s.unpackRawPoints();
+  }
+  if (!s.pts.isSpan()) points_.release(before);
+  strokeBounds_[idx] = s.bounds();
+  emit strokeModified(id, idx, oldInk, inkBounds(s, strokeBounds_[idx]));
+  notifyChanged();
 }
 
 int Document::insertTextBox(int index, TextBox t) {
+  VELLUM_TRACE_SCOPE("document", "Document::insertTextBox");
   if (index < 0 || index > textBoxes_.size()) index = textBoxes_.size();
   textBoxes_.insert(index, std::move(t));
-  emit changed();
+  emit textBoxAdded(textBoxes_[index].id, textBoxes_[index].rectWorld);
+  notifyChanged();
   return index;
 }
 
 TextBox Document::takeTextBoxAt(int index) {
+  VELLUM_TRACE_SCOPE("document", "Document::takeTextBoxAt");
   if (index < 0 || index >= textBoxes_.size()) return TextBox{};
   TextBox t = textBoxes_.takeAt(index);
-  emit changed();
+  emit textBoxRemoved(t.id, t.rectWorld);
+  notifyChanged();
   return t;
 }
 
@@ -73,17 +212,87 @@ int Document::textBoxIndexById(qint64 id) const {
 }
 
 void Document::setTextBoxRectById(qint64 id, const QRectF& r) {
+  VELLUM_TRACE_SCOPE("document", "Document::setTextBoxRectById");
   const int idx = textBoxIndexById(id);
   if (idx < 0) return;
+  const QRectF old = textBoxes_[idx].rectWorld;
   textBoxes_[idx].rectWorld = r;
-  emit changed();
+  emit textBoxChanged(id, old, r);
+  notifyChanged();
 }
 
 void Document::setTextBoxMarkdownById(qint64 id, const QString& md) {
+  VELLUM_TRACE_SCOPE("document", "Document::setTextBoxMarkdownById");
   const int idx = textBoxIndexById(id);
   if (idx < 0) return;
   textBoxes_[idx].markdown = md;
-  emit changed();
+  emit textBoxChanged(id, textBoxes_[idx].rectWorld, textBoxes_[idx].rectWorld);
+  notifyChanged();
+}
+
+DocumentStats Document::stats() const {
+  DocumentStats st;
+  st.strokes = strokes_.size();
+  st.strokeBytes = strokes_.capacity() * qint64(sizeof(Stroke));
+  for (int i = 0; i < strokes_.size(); ++i) {
+    const Stroke& s = strokes_[i];
+    st.points += s.pts.size();
+    st.ownedPointBytes += s.pts.byteSize();
+    if (s.isShape) ++st.shapes;
+    st.shapeBytes +=
+        s.shapeType.capacity() * qint64(sizeof(QChar)) + s.shapeParams.capacity() + s.rawPointsZ.capacity();
+    st.worldBounds = st.worldBounds.united(inkBounds(s, strokeBounds_[i]));
+  }
+  st.arenaBytes = points_.byteSize();
+  st.arenaDeadPoints = points_.deadPoints();
+
+  st.textBoxes = textBoxes_.size();
+  st.textBytes = textBoxes_.capacity() * qint64(sizeof(TextBox));
+  for (const TextBox& t : textBoxes_) {
+    st.textChars += t.markdown.size();
+    st.textBytes += t.markdown.capacity() * qint64(sizeof(QChar));
+    st.worldBounds = st.worldBounds.united(t.rectWorld);
+  }
+
+  st.cacheBytes = strokeBounds_.capacity() * qint64(sizeof(QRectF));
+  st.undoBytes = undoMemoryUsage();
+  st.undoCommands = undo_.count();
+  return st;
+}
+
+qint64 DocumentStats::totalBytes() const {
+  return strokeBytes + arenaBytes + ownedPointBytes + shapeBytes + textBytes + cacheBytes + undoBytes;
+}
+
+static QString formatBytes(qint64 bytes) {
+  if (bytes < 1024) return QString("%1 B").arg(bytes);
+  if (bytes < 1024 * 1024) return QString("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1);
+  return QString("%1 MiB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+QString DocumentStats::describe() const {
+  QString out;
+  auto row = [&](const char* label, const QString& value) {
+    out += QString("%1 %2\n").arg(QString(label) + ':', -18).arg(value);
+  };
+  row("strokes", QString("%1 (%2 shapes)").arg(strokes).arg(shapes));
+  row("points", QString::number(points));
+  row("text boxes", QString("%1 (%2 chars)").arg(textBoxes).arg(textChars));
+  row("world bounds", worldBounds.isNull() ? QString("-")
+                                           : QString("%1 x %2 at (%3, %4)")
+                                                 .arg(worldBounds.width(), 0, 'f', 0)
+                                                 .arg(worldBounds.height(), 0, 'f', 0)
+                                                 .arg(worldBounds.left(), 0, 'f', 0)
+                                                 .arg(worldBounds.top(), 0, 'f', 0));
+  row("stroke records", formatBytes(strokeBytes));
+  row("point arena", QString("%1 (%2 dead points)").arg(formatBytes(arenaBytes)).arg(arenaDeadPoints));
+  row("owned points", formatBytes(ownedPointBytes));
+  row("shapes", formatBytes(shapeBytes));
+  row("text", formatBytes(textBytes));
+  row("caches", formatBytes(cacheBytes));
+  row("undo history", QString("%1 (%2 commands)").arg(formatBytes(undoBytes)).arg(undoCommands));
+  row("total", formatBytes(totalBytes()));
+  return out;
 }
 
 qint64 Document::nextStrokeId() {
@@ -98,3 +307,29 @@ void Document::setNextIds(qint64 nextStrokeId, qint64 nextTextBoxId) {
   nextStrokeId_ = std::max<qint64>(1, nextStrokeId);
   nextTextBoxId_ = std::max<qint64>(1, nextTextBoxId);
 }
+
+void Document::beginBatch() {
+  if (batchDepth_++ == 0) emit batchStarted();
+}
+
+void Document::endBatch() {
+  if (batchDepth_ == 0 || --batchDepth_ > 0) return;
+  emit batchFinished();
+  if (batchDirty_) {
+    batchDirty_ = false;
+    emit changed();
+  }
+}
+
+void Document::notifyChanged() {
+  if (batchDepth_ > 0) {
+    batchDirty_ = true;
+    return;
+  }
+  emit changed();
+}
+
+QRectF Document::inkBounds(const Stroke& s, const QRectF& pointBounds) {
+  const double w = s.baseWidthPoints;
+  return pointBounds.adjusted(-w, -w, w, w);
+}
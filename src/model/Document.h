@@ -4,9 +4,37 @@
 #include <QUndoStack>
 #include <QVector>
 
+#include "model/PointArena.h"
 #include "model/Stroke.h"
 #include "model/TextBox.h"
 
+// Content counts and memory use of a Document, from Document::stats().
+// Byte figures are heap capacity plus the fixed size of each element.
+struct DocumentStats {
+  qint64 strokes = 0;
+  qint64 shapes = 0;  // recognized shapes
+  qint64 points = 0;  // samples across strokes (outlines for packed shapes)
+  qint64 textBoxes = 0;
+  qint64 textChars = 0;
+
+  qint64 strokeBytes = 0;       // Stroke records
+  qint64 arenaBytes = 0;        // point arena, reserved
+  qint64 arenaDeadPoints = 0;   // arena points of removed strokes
+  qint64 ownedPointBytes = 0;   // points outside the arena (drawn since load)
+  qint64 shapeBytes = 0;        // shape types, params and packed raw samples
+  qint64 textBytes = 0;
+  qint64 cacheBytes = 0;        // derived data (stroke bounds)
+  qint64 undoBytes = 0;
+  qint64 undoCommands = 0;
+
+  // Union of all ink bounds and text box rects; null for an empty document.
+  QRectF worldBounds;
+
+  qint64 totalBytes() const;
+  // Multi-line "label: value" report for logs, the CLI and debug UI.
+  QString describe() const;
+};
+
 class Document : public QObject {
   Q_OBJECT
  public:
@@ -20,13 +48,42 @@ class Document : public QObject {
   void setViewMode(ViewMode m);
 
   const QVector<Stroke>& strokes() const { return strokes_; }
+  // Point bounds of each stroke, parallel to strokes() (pen width not
+  // included). Kept up to date on every mutation, for cheap culling.
+  const QVector<QRectF>& strokeBounds() const { return strokeBounds_; }
   const QVector<TextBox>& textBoxes() const { return textBoxes_; }
 
   QUndoStack* undoStack() { return &undo_; }
+  // Undo/redo through the stack, announced first with aboutToUndoRedo() so
+  // editors can push edits they are still holding back.
+  void undo();
+  void redo();
+
+  // The undo history is held under this many bytes: the oldest payloads
+  // are compressed first, and if that isn't enough the oldest entries (then
+  // the furthest redo entries) are dropped. The count limit still applies.
+  void setUndoMemoryBudget(qint64 bytes);
+  qint64 undoMemoryBudget() const { return undoBudget_; }
+  qint64 undoMemoryUsage() const;
+
+  // Bytes reserved by the point arena (loaded and compacted strokes).
+  qint64 pointStorageBytes() const { return points_.byteSize(); }
+  // Walks every stroke and text box; O(content), meant for diagnostics and
+  // budget checks rather than per-frame use.
+  DocumentStats stats() const;
+  // Repacks stroke points into the arena, dropping the space left by
+  // removed strokes and folding in strokes that still own their points.
+  // Runs on its own once enough has been removed.
+  void compactPoints();
 
   // Internal mutation points used by undo commands / loaders.
+  // Inserting keeps the stroke's points as they are (moving a freshly drawn
+  // stroke in is O(1)); taken strokes always come back owning theirs.
   int insertStroke(int index, Stroke s);
   Stroke takeStrokeAt(int index);
+  // Copies points into the arena up front, so loaders can fill one scratch
+  // buffer per stroke instead of allocating a fresh one.
+  StrokePoints internPoints(const StrokePoints& pts) { return points_.intern(pts); }
   int strokeIndexById(qint64 id) const;
   void setStrokeShapeById(qint64 id, bool isShape, const QString& type,
                          const QByteArray& params);
@@ -41,15 +98,57 @@ class Document : public QObject {
   qint64 nextTextBoxId();
   void setNextIds(qint64 nextStrokeId, qint64 nextTextBoxId);
 
+  // Groups edits (loading, multi-stroke operations): typed signals still
+  // fire per edit, but changed() is held back and sent once at the end.
+  // Nests; only the outermost pair emits batchStarted/batchFinished.
+  void beginBatch();
+  void endBatch();
+  bool isInBatch() const { return batchDepth_ > 0; }
+
+  // World bounds of a stroke's ink: its point bounds padded by the pen
+  // width. This is what the stroke signals report.
+  static QRectF inkBounds(const Stroke& s, const QRectF& pointBounds);
+
  signals:
+  // Something changed; sent after every edit, or once per batch.
   void changed();
   void viewModeChanged(Document::ViewMode);
 
+  // Typed notifications, sent as each edit happens, so caches and indexes
+  // can update in proportion to the edit. Indexes are positions in
+  // strokes() after an add and before a remove.
+  void strokeAdded(qint64 id, int index, const QRectF& inkBounds);
+  void strokeRemoved(qint64 id, int index, const QRectF& inkBounds);
+  void strokeModified(qint64 id, int index, const QRectF& oldInkBounds, const QRectF& newInkBounds);
+  void textBoxAdded(qint64 id, const QRectF& rect);
+  void textBoxRemoved(qint64 id, const QRectF& rect);
+  // Rect and/or markdown changed.
+  void textBoxChanged(qint64 id, const QRectF& oldRect, const QRectF& newRect);
+  // Sent by undo()/redo() before the stack moves.
+  void aboutToUndoRedo();
+  // All content was dropped (clear(), loading); rebuild instead of updating.
+  void documentReset();
+  void batchStarted();
+  void batchFinished();
+
  private:
   ViewMode viewMode_ = ViewMode::Infinite;
   QVector<Stroke> strokes_;
+  QVector<QRectF> strokeBounds_;
   QVector<TextBox> textBoxes_;
+  PointArena points_;
+  void enforceUndoBudget();
+  void rebuildUndoStack(int first, int end);
+  void notifyChanged();
+
+  int batchDepth_ = 0;
+  bool batchDirty_ = false;
+
+  // A child, so moveToThread() takes it along with the document (the app
+  // loads recent documents on a worker thread).
   QUndoStack undo_;
+  qint64 undoBudget_ = 64 * 1024 * 1024;
+  bool rebuildingUndo_ = false;
   qint64 nextStrokeId_ = 1;
   qint64 nextTextBoxId_ = 1;
 };
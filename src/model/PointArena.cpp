@@ -0,0 +1,76 @@
+#include "PointArena.h"
+
+#include <algorithm>
+
+// Points per slab; longer strokes get a slab of their own.
+static constexpr qsizetype kSlabPoints = 64 * 1024;
+// Don't bother repacking for less dead space than this.
+static constexpr qsizetype kMinDeadPoints = 16 * 1024;
+
+PointArena::Slab& PointArena::slabFor(qsizetype count) {
+  if (!slabs_.empty()) {
+    Slab& last = slabs_.back();
+    if (last.dx.size() - last.used >= count) return last;
+  }
+  const qsizetype cap = std::max(kSlabPoints, count);
+  Slab slab;
+  slab.dx.resize(cap);
+  slab.dy.resize(cap);
+  slab.pressure.resize(cap);
+  slab.dt.resize(cap);
+  slabs_.push_back(std::move(slab));
+  return slabs_.back();
+}
+
+StrokePoints PointArena::intern(const StrokePoints& pts) {
+  const qsizetype n = pts.size();
+  if (n == 0) return StrokePoints();
+
+  Slab& slab = slabFor(n);
+  // The slab is never shared, so data() doesn't detach.
+  float* dx = slab.dx.data() + slab.used;
+  float* dy = slab.dy.data() + slab.used;
+  quint16* pressure = slab.pressure.data() + slab.used;
+  quint32* dt = slab.dt.data() + slab.used;
+  std::copy_n(pts.dx_, n, dx);
+  std::copy_n(pts.dy_, n, dy);
+  std::copy_n(pts.pressure_, n, pressure);
+  std::copy_n(pts.dt_, n, dt);
+  slab.used += n;
+  live_ += n;
+
+  StrokePoints out;
+  out.ox_ = pts.ox_;
+  out.oy_ = pts.oy_;
+  out.t0_ = pts.t0_;
+  out.n_ = n;
+  out.span_ = true;
+  out.dx_ = dx;
+  out.dy_ = dy;
+  out.pressure_ = pressure;
+  out.dt_ = dt;
+  return out;
+}
+
+void PointArena::release(qsizetype count) {
+  count = std::min(count, live_);
+  live_ -= count;
+  dead_ += count;
+}
+
+void PointArena::clear() {
+  slabs_.clear();
+  live_ = 0;
+  dead_ = 0;
+}
+
+bool PointArena::wantsCompaction() const {
+  return dead_ >= kMinDeadPoints && dead_ > live_;
+}
+
+qint64 PointArena::byteSize() const {
+  constexpr qint64 kPointBytes = 2 * sizeof(float) + sizeof(quint16) + sizeof(quint32);
+  qint64 bytes = 0;
+  for (const Slab& slab : slabs_) bytes += slab.dx.capacity() * kPointBytes;
+  return bytes;
+}
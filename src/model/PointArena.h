@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QVector>
+
+#include <vector>
+
+#include "model/StrokePoints.h"
+
+// Slab storage for the points of every stroke a Document holds. Strokes
+// reference spans in it instead of owning four small arrays each, so
+// loading, clearing and walking a large document touch a handful of big
+// blocks. Spans stay valid until clear() or until the owner repacks the
+// arena after deletes.
+class PointArena {
+ public:
+  PointArena() = default;
+  PointArena(const PointArena&) = delete;
+  PointArena& operator=(const PointArena&) = delete;
+  PointArena(PointArena&&) = default;
+  PointArena& operator=(PointArena&&) = default;
+
+  // Copies `pts` into the arena and returns a span over the copy.
+  StrokePoints intern(const StrokePoints& pts);
+  // Marks `count` interned points as no longer referenced.
+  void release(qsizetype count);
+  void clear();
+
+  qsizetype livePoints() const { return live_; }
+  qsizetype deadPoints() const { return dead_; }
+  // Worth repacking: most of the stored points belong to removed strokes.
+  bool wantsCompaction() const;
+
+  // Bytes reserved by all slabs.
+  qint64 byteSize() const;
+
+ private:
+  struct Slab {
+    QVector<float> dx;
+    QVector<float> dy;
+    QVector<quint16> pressure;
+    QVector<quint32> dt;
+    qsizetype used = 0;
+  };
+
+  Slab& slabFor(qsizetype count);
+
+  // std::vector moves slabs on growth, which keeps each column's buffer
+  // (and so every span into it) in place.
+  std::vector<Slab> slabs_;
+  qsizetype live_ = 0;
+  qsizetype dead_ = 0;
+};
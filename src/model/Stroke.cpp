@@ -1,9 +1,131 @@
 #include "Stroke.h"
 
+#include <QDataStream>
+#include <QIODevice>
+#include <QtMath>
+
+namespace {
+constexpr int kCircleOutlineSegments = 48;
+}  // namespace
+
 QRectF Stroke::bounds() const {
-  if (pts.isEmpty()) return QRectF();
-  QRectF r(pts[0].worldPos, QSizeF(0, 0));
-  for (const auto& p : pts) r |= QRectF(p.worldPos, QSizeF(0, 0));
-  return r;
+  return pts.bounds();
+}
+
+qint64 Stroke::byteSize() const {
+  return sizeof(Stroke) + pts.byteSize() +
+         shapeType.capacity() * qint64(sizeof(QChar)) + shapeParams.capacity() + rawPointsZ.capacity();
+}
+
+void Stroke::packRawPoints() {
+  if (!isShape || shapeType.isEmpty()) return;
+
+  float pressure = 1.0f;
+  if (!pts.isEmpty()) {
+    float sum = 0.0f;
+    for (qsizetype i = 0; i < pts.size(); ++i) sum += pts.pressure(i);
+    pressure = sum / static_cast<float>(pts.size());
+  }
+
+  StrokePoints outline = shapeOutline(pressure);
+  if (outline.size() < 2) return;
+
+  if (rawPointsZ.isEmpty()) rawPointsZ = qCompress(packStrokePoints(pts));
+  pts = std::move(outline);
+}
+
+void Stroke::unpackRawPoints() {
+  if (rawPointsZ.isEmpty()) return;
+  pts = unpackStrokePoints(qUncompress(rawPointsZ));
+  rawPointsZ.clear();
 }
 
+StrokePoints Stroke::shapeOutline(float pressure) const {
+  StrokePoints out;
+  QDataStream ds(shapeParams);
+  ds.setVersion(QDataStream::Qt_6_0);
+
+  auto add = [&](const QPointF& p) { out.append(p, pressure, 0); };
+
+  if (shapeType == "line") {
+    QPointF a, b;
+    ds >> a >> b;
+    if (ds.status() != QDataStream::Ok) return {};
+    add(a);
+    add(b);
+  } else if (shapeType == "circle") {
+    QPointF c;
+    double r = 0;
+    ds >> c >> r;
+    if (ds.status() != QDataStream::Ok || r <= 0) return {};
+    out.reserve(kCircleOutlineSegments + 1);
+    for (int i = 0; i <= kCircleOutlineSegments; ++i) {
+      const double a = (2.0 * M_PI * i) / kCircleOutlineSegments;
+      add(c + QPointF(r * std::cos(a), r * std::sin(a)));
+    }
+  } else if (shapeType == "rect") {
+    QRectF r;
+    ds >> r;
+    if (ds.status() != QDataStream::Ok) return {};
+    add(r.topLeft());
+    add(r.topRight());
+    add(r.bottomRight());
+    add(r.bottomLeft());
+    add(r.topLeft());
+  }
+  return out;
+}
+
+// Columns are written one after another (all x, all y, ...) and timestamps
+// as deltas, which zlib compresses far better than interleaved records.
+QByteArray packStrokePoints(const StrokePoints& pts) {
+  QByteArray out;
+  QDataStream ds(&out, QIODevice::WriteOnly);
+  ds.setVersion(QDataStream::Qt_6_0);
+  ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+  const qsizetype n = pts.size();
+  ds << static_cast<quint32>(n);
+  for (qsizetype i = 0; i < n; ++i) ds << pts.pos(i).x();
+  for (qsizetype i = 0; i < n; ++i) ds << pts.pos(i).y();
+  ds.setFloatingPointPrecision(QDataStream::SinglePrecision);
+  for (qsizetype i = 0; i < n; ++i) ds << pts.pressure(i);
+  qint64 prevT = 0;
+  for (qsizetype i = 0; i < n; ++i) {
+    ds << (pts.tMs(i) - prevT);
+    prevT = pts.tMs(i);
+  }
+  return out;
+}
+
+StrokePoints unpackStrokePoints(const QByteArray& packed) {
+  QDataStream ds(packed);
+  ds.setVersion(QDataStream::Qt_6_0);
+  ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+  quint32 n = 0;
+  ds >> n;
+  // 8 + 8 + 4 + 8 bytes per point; reject counts the payload can't hold.
+  if (ds.status() != QDataStream::Ok || n > static_cast<quint32>(packed.size() / 28)) return {};
+
+  QVector<double> xs(n);
+  QVector<double> ys(n);
+  QVector<float> prs(n);
+  for (auto& x : xs) ds >> x;
+  for (auto& y : ys) ds >> y;
+  ds.setFloatingPointPrecision(QDataStream::SinglePrecision);
+  for (auto& pr : prs) ds >> pr;
+  if (ds.status() != QDataStream::Ok) return {};
+
+  StrokePoints pts;
+  pts.reserve(n);
+  qint64 t = 0;
+  for (quint32 i = 0; i < n; ++i) {
+    qint64 dt = 0;
+    ds >> dt;
+    t += dt;
+    pts.append(QPointF(xs[i], ys[i]), prs[i], t);
+  }
+  if (ds.status() != QDataStream::Ok) return {};
+  return pts;
+}
@@ -6,15 +6,11 @@
 #include <QRectF>
 #include <QVector>
 
-struct StrokePoint {
-  QPointF worldPos;
-  float pressure = 1.0f;  // 0..1
-  qint64 tMs = 0;
-};
+#include "model/StrokePoints.h"
 
 struct Stroke {
   qint64 id = -1;
-  QVector<StrokePoint> pts;
+  StrokePoints pts;
   QColor color = QColor(20, 20, 20);
   double baseWidthPoints = 2.0;
 
@@ -23,6 +19,24 @@ struct Stroke {
   QString shapeType;       // e.g. "line", "circle", "rect"
   QByteArray shapeParams;  // binary blob (QDataStream)
 
+  // Raw samples of a recognized shape, packed and qCompress'd. While set,
+  // `pts` only holds the outline generated from shapeParams.
+  QByteArray rawPointsZ;
+
   QRectF bounds() const;
+  // Heap + inline bytes held by this stroke.
+  qint64 byteSize() const;
+
+  bool hasPackedRawPoints() const { return !rawPointsZ.isEmpty(); }
+  // Moves the raw samples into rawPointsZ and replaces them with the shape
+  // outline. No-op unless the stroke is a shape with decodable params.
+  void packRawPoints();
+  // Restores the raw samples dropped by packRawPoints().
+  void unpackRawPoints();
+
+  // Coarse polyline of the recognized shape (empty if params don't decode).
+  StrokePoints shapeOutline(float pressure) const;
 };
 
+QByteArray packStrokePoints(const StrokePoints& pts);
+StrokePoints unpackStrokePoints(const QByteArray& packed);
@@ -0,0 +1,173 @@
+#include "StrokePoints.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <limits>
+
+StrokePoints::StrokePoints(const StrokePoints& o)
+    : ox_(o.ox_),
+      oy_(o.oy_),
+      t0_(o.t0_),
+      n_(o.n_),
+      ownDx_(o.ownDx_),
+      ownDy_(o.ownDy_),
+      ownPressure_(o.ownPressure_),
+      ownDt_(o.ownDt_) {
+  if (o.span_) {
+    ownDx_ = QVector<float>(o.dx_, o.dx_ + n_);
+    ownDy_ = QVector<float>(o.dy_, o.dy_ + n_);
+    ownPressure_ = QVector<quint16>(o.pressure_, o.pressure_ + n_);
+    ownDt_ = QVector<quint32>(o.dt_, o.dt_ + n_);
+  }
+  bindOwned();
+}
+
+StrokePoints::StrokePoints(StrokePoints&& o) noexcept
+    : ox_(o.ox_),
+      oy_(o.oy_),
+      t0_(o.t0_),
+      n_(o.n_),
+      span_(o.span_),
+      dx_(o.dx_),
+      dy_(o.dy_),
+      pressure_(o.pressure_),
+      dt_(o.dt_),
+      ownDx_(std::move(o.ownDx_)),
+      ownDy_(std::move(o.ownDy_)),
+      ownPressure_(std::move(o.ownPressure_)),
+      ownDt_(std::move(o.ownDt_)) {
+  // Moving a QVector keeps its buffer, so owned views stay valid.
+  o.reset();
+}
+
+StrokePoints& StrokePoints::operator=(const StrokePoints& o) {
+  if (this != &o) *this = StrokePoints(o);
+  return *this;
+}
+
+StrokePoints& StrokePoints::operator=(StrokePoints&& o) noexcept {
+  if (this == &o) return *this;
+  ox_ = o.ox_;
+  oy_ = o.oy_;
+  t0_ = o.t0_;
+  n_ = o.n_;
+  span_ = o.span_;
+  dx_ = o.dx_;
+  dy_ = o.dy_;
+  pressure_ = o.pressure_;
+  dt_ = o.dt_;
+  ownDx_ = std::move(o.ownDx_);
+  ownDy_ = std::move(o.ownDy_);
+  ownPressure_ = std::move(o.ownPressure_);
+  ownDt_ = std::move(o.ownDt_);
+  o.reset();
+  return *this;
+}
+
+void StrokePoints::bindOwned() {
+  span_ = false;
+  dx_ = ownDx_.constData();
+  dy_ = ownDy_.constData();
+  pressure_ = ownPressure_.constData();
+  dt_ = ownDt_.constData();
+}
+
+void StrokePoints::reset() {
+  ownDx_.clear();
+  ownDy_.clear();
+  ownPressure_.clear();
+  ownDt_.clear();
+  n_ = 0;
+  ox_ = oy_ = 0.0;
+  t0_ = 0;
+  bindOwned();
+}
+
+void StrokePoints::detach() {
+  if (!span_) return;
+  ownDx_ = QVector<float>(dx_, dx_ + n_);
+  ownDy_ = QVector<float>(dy_, dy_ + n_);
+  ownPressure_ = QVector<quint16>(pressure_, pressure_ + n_);
+  ownDt_ = QVector<quint32>(dt_, dt_ + n_);
+  bindOwned();
+}
+
+void StrokePoints::reserve(qsizetype n) {
+  detach();
+  ownDx_.reserve(n);
+  ownDy_.reserve(n);
+  ownPressure_.reserve(n);
+  ownDt_.reserve(n);
+  bindOwned();
+}
+
+void StrokePoints::clear() {
+  reset();
+}
+
+void StrokePoints::append(const QPointF& pos, float pressure, qint64 tMs) {
+  detach();
+  if (isEmpty()) {
+    ox_ = pos.x();
+    oy_ = pos.y();
+    t0_ = tMs;
+  }
+  ownDx_.push_back(static_cast<float>(pos.x() - ox_));
+  ownDy_.push_back(static_cast<float>(pos.y() - oy_));
+  ownPressure_.push_back(static_cast<quint16>(qRound(std::clamp(pressure, 0.0f, 1.0f) * kPressureScale)));
+  // Samples arrive in time order; clamp anything that doesn't fit the delta.
+  const qint64 dt = std::clamp<qint64>(tMs - t0_, 0, std::numeric_limits<quint32>::max());
+  ownDt_.push_back(static_cast<quint32>(dt));
+  ++n_;
+  bindOwned();
+}
+
+QRectF StrokePoints::bounds() const {
+  const qsizetype n = size();
+  if (n == 0) return QRectF();
+  const float* xs = dx_;
+  const float* ys = dy_;
+  float minX = xs[0], maxX = xs[0];
+  float minY = ys[0], maxY = ys[0];
+  for (qsizetype i = 1; i < n; ++i) {
+    minX = std::min(minX, xs[i]);
+    maxX = std::max(maxX, xs[i]);
+    minY = std::min(minY, ys[i]);
+    maxY = std::max(maxY, ys[i]);
+  }
+  return QRectF(QPointF(ox_ + minX, oy_ + minY), QPointF(ox_ + maxX, oy_ + maxY));
+}
+
+bool StrokePoints::intersectsDisc(const QPointF& c, double radius) const {
+  const qsizetype n = size();
+  if (n == 0) return false;
+  const float* xs = dx_;
+  const float* ys = dy_;
+  // Work in the stroke's local frame so far-out coordinates don't lose bits.
+  const double cx = c.x() - ox_;
+  const double cy = c.y() - oy_;
+  const double r2 = radius * radius;
+
+  if (n == 1) {
+    const double dx = xs[0] - cx;
+    const double dy = ys[0] - cy;
+    return dx * dx + dy * dy <= r2;
+  }
+  for (qsizetype i = 1; i < n; ++i) {
+    const double ax = xs[i - 1], ay = ys[i - 1];
+    const double abx = xs[i] - ax, aby = ys[i] - ay;
+    const double ab2 = abx * abx + aby * aby;
+    double t = 0.0;
+    if (ab2 > 1e-9) t = std::clamp(((cx - ax) * abx + (cy - ay) * aby) / ab2, 0.0, 1.0);
+    const double dx = ax + abx * t - cx;
+    const double dy = ay + aby * t - cy;
+    if (dx * dx + dy * dy <= r2) return true;
+  }
+  return false;
+}
+
+qint64 StrokePoints::byteSize() const {
+  return ownDx_.capacity() * qint64(sizeof(float)) + ownDy_.capacity() * qint64(sizeof(float)) +
+         ownPressure_.capacity() * qint64(sizeof(quint16)) + ownDt_.capacity() * qint64(sizeof(quint32));
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+
+#include <iterator>
+
+struct StrokePoint {
+  QPointF worldPos;
+  float pressure = 1.0f;  // 0..1
+  qint64 tMs = 0;
+};
+
+// Columnar point storage: x, y, pressure and time live in separate
+// contiguous arrays, so geometry kernels stream only the coordinates.
+// Element access and iteration hand out StrokePoint values, which keeps
+// code written against QVector<StrokePoint> working unchanged.
+//
+// Points are stored compactly relative to a per-stroke double origin (the
+// first point): float offsets, 16-bit pressure and 32-bit time deltas from
+// the first timestamp, 14 bytes per point instead of 28. A stroke spans at
+// most a few thousand world units, where float offsets keep sub-0.001 unit
+// precision no matter how far out on the canvas the origin is.
+//
+// The columns are either owned or a span inside a Document's PointArena.
+// Copying a span yields an owned deep copy; moving keeps the span. Appending
+// to a span detaches it first.
+class StrokePoints {
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = StrokePoint;
+    using difference_type = qsizetype;
+    using pointer = void;
+    using reference = StrokePoint;
+
+    const_iterator() = default;
+    const_iterator(const StrokePoints* c, qsizetype i) : c_(c), i_(i) {}
+
+    StrokePoint operator*() const { return (*c_)[i_]; }
+    const_iterator& operator++() {
+      ++i_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++i_;
+      return old;
+    }
+    bool operator==(const const_iterator& o) const { return i_ == o.i_; }
+    bool operator!=(const const_iterator& o) const { return i_ != o.i_; }
+
+   private:
+    const StrokePoints* c_ = nullptr;
+    qsizetype i_ = 0;
+  };
+
+  StrokePoints() = default;
+  StrokePoints(const StrokePoints& o);
+  StrokePoints(StrokePoints&& o) noexcept;
+  StrokePoints& operator=(const StrokePoints& o);
+  StrokePoints& operator=(StrokePoints&& o) noexcept;
+  ~StrokePoints() = default;
+
+  qsizetype size() const { return n_; }
+  bool isEmpty() const { return n_ == 0; }
+  // True while the columns live in a PointArena rather than in this object.
+  bool isSpan() const { return span_; }
+  // Copies a span into owned columns; no-op for owned points.
+  void detach();
+  void reserve(qsizetype n);
+  void clear();
+
+  void push_back(const StrokePoint& p) { append(p.worldPos, p.pressure, p.tMs); }
+  void append(const QPointF& pos, float pressure, qint64 tMs);
+
+  StrokePoint operator[](qsizetype i) const { return StrokePoint{pos(i), pressure(i), tMs(i)}; }
+  StrokePoint front() const { return (*this)[0]; }
+  StrokePoint back() const { return (*this)[size() - 1]; }
+
+  QPointF pos(qsizetype i) const { return QPointF(ox_ + double(dx_[i]), oy_ + double(dy_[i])); }
+  float pressure(qsizetype i) const { return pressure_[i] / kPressureScale; }
+  qint64 tMs(qsizetype i) const { return t0_ + dt_[i]; }
+
+  // World position of the first point; the offset columns are relative to it.
+  QPointF origin() const { return QPointF(ox_, oy_); }
+  const float* xOffsetData() const { return dx_; }
+  const float* yOffsetData() const { return dy_; }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+  // Geometry kernels over the x/y columns only.
+  QRectF bounds() const;
+  // True if any segment of the polyline comes within `radius` of `c`.
+  bool intersectsDisc(const QPointF& c, double radius) const;
+
+  // Heap bytes held by owned columns (spans are accounted by their arena).
+  qint64 byteSize() const;
+
+ private:
+  friend class PointArena;
+  static constexpr float kPressureScale = 65535.0f;
+
+  // Points the column views at the owned vectors.
+  void bindOwned();
+  void reset();
+
+  double ox_ = 0.0;
+  double oy_ = 0.0;
+  qint64 t0_ = 0;
+  qsizetype n_ = 0;
+  bool span_ = false;
+
+  // Column views used by every accessor.
+  const float* dx_ = nullptr;
+  const float* dy_ = nullptr;
+  const quint16* pressure_ = nullptr;
+  const quint32* dt_ = nullptr;
+
+  QVector<float> ownDx_;
+  QVector<float> ownDy_;
+  QVector<quint16> ownPressure_;
+  QVector<quint32> ownDt_;
+};
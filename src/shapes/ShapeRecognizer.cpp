@@ -6,25 +6,35 @@
 #include <QPainterPath>
 #include <algorithm>
 
+#include "trace/Trace.h"
+
 // --- Helper Functions ---
 
-static QPointF centroid(const QVector<StrokePoint>& pts) {
-    QPointF c(0, 0);
-    if (pts.isEmpty()) return c;
-    for (const auto& p : pts) c += p.worldPos;
-    return c / pts.size();
+static QPointF centroid(const StrokePoints& pts) {
+    if (pts.isEmpty()) return QPointF(0, 0);
+    const float* xs = pts.xOffsetData();
+    const float* ys = pts.yOffsetData();
+    double sx = 0, sy = 0;
+    for (qsizetype i = 0; i < pts.size(); ++i) {
+        sx += xs[i];
+        sy += ys[i];
+    }
+    return pts.origin() + QPointF(sx, sy) / pts.size();
 }
 
-static double meanRadius(const QVector<StrokePoint>& pts, const QPointF& c, double* stddevOut) {
+static double meanRadius(const StrokePoints& pts, const QPointF& c, double* stddevOut) {
     if (pts.isEmpty()) {
         if (stddevOut) *stddevOut = 0;
         return 0;
     }
+    const float* xs = pts.xOffsetData();
+    const float* ys = pts.yOffsetData();
+    const QPointF lc = c - pts.origin();
     double sum = 0;
     QVector<double> rs;
     rs.reserve(pts.size());
-    for (const auto& p : pts) {
-        double r = QLineF(c, p.worldPos).length();
+    for (qsizetype i = 0; i < pts.size(); ++i) {
+        double r = std::hypot(xs[i] - lc.x(), ys[i] - lc.y());
         rs.push_back(r);
         sum += r;
     }
@@ -38,17 +48,14 @@ static double meanRadius(const QVector<StrokePoint>& pts, const QPointF& c, doub
     return mean;
 }
 
-static QRectF boundsOf(const QVector<StrokePoint>& pts) {
-    if (pts.isEmpty()) return QRectF();
-    QRectF r(pts[0].worldPos, QSizeF(0, 0));
-    for (const auto& p : pts) r |= QRectF(p.worldPos, QSizeF(0, 0));
-    return r;
+static QRectF boundsOf(const StrokePoints& pts) {
+    return pts.bounds();
 }
 
-static bool isClosedish(const QVector<StrokePoint>& pts, double diag) {
+static bool isClosedish(const StrokePoints& pts, double diag) {
     if (pts.size() < 6) return false;
     // Closing threshold: within 25% of the bounding box diagonal
-    return QLineF(pts.front().worldPos, pts.back().worldPos).length() < (diag * 0.25);
+    return QLineF(pts.pos(0), pts.pos(pts.size() - 1)).length() < (diag * 0.25);
 }
 
 // --- Refined Matchers ---
@@ -57,20 +64,21 @@ static ShapeMatch matchLine(const Stroke& s) {
     ShapeMatch m;
     if (s.pts.size() < 2) return m;
 
-    QPointF p0 = s.pts.front().worldPos;
-    QPointF p1 = s.pts.back().worldPos;
+    QPointF p0 = s.pts.pos(0);
+    QPointF p1 = s.pts.pos(s.pts.size() - 1);
     QLineF ideal(p0, p1);
     double len = ideal.length();
     if (len < 15.0) return m;
 
     double totalErr = 0;
-    for (const auto& p : s.pts) {
+    const QPointF v = p1 - p0;
+    const double vv = QPointF::dotProduct(v, v);
+    for (qsizetype i = 0; i < s.pts.size(); ++i) {
         // Distance from point to the finite line segment
-        QPointF v = p1 - p0;
-        QPointF w = p.worldPos - p0;
-        double t = std::clamp(QPointF::dotProduct(w, v) / QPointF::dotProduct(v, v), 0.0, 1.0);
+        const QPointF p = s.pts.pos(i);
+        double t = std::clamp(QPointF::dotProduct(p - p0, v) / vv, 0.0, 1.0);
         QPointF projection = p0 + t * v;
-        totalErr += QLineF(p.worldPos, projection).length();
+        totalErr += QLineF(p, projection).length();
     }
 
     double avgErr = totalErr / s.pts.size();
@@ -119,9 +127,12 @@ static ShapeMatch matchRect(const Stroke& s) {
 
     int hits = 0;
     double tol = diag * 0.05; // 5% of diagonal as snap tolerance
-    for (const auto& p : s.pts) {
-        double dx = std::min(std::abs(p.worldPos.x() - b.left()), std::abs(p.worldPos.x() - b.right()));
-        double dy = std::min(std::abs(p.worldPos.y() - b.top()), std::abs(p.worldPos.y() - b.bottom()));
+    const float* xs = s.pts.xOffsetData();
+    const float* ys = s.pts.yOffsetData();
+    const QRectF lb = b.translated(-s.pts.origin());
+    for (qsizetype i = 0; i < s.pts.size(); ++i) {
+        double dx = std::min(std::abs(xs[i] - lb.left()), std::abs(xs[i] - lb.right()));
+        double dy = std::min(std::abs(ys[i] - lb.top()), std::abs(ys[i] - lb.bottom()));
         if (std::min(dx, dy) < tol) hits++;
     }
 
@@ -137,6 +148,7 @@ static ShapeMatch matchRect(const Stroke& s) {
 }
 
 ShapeMatch ShapeRecognizer::recognize(const Stroke& stroke) {
+    VELLUM_TRACE_SCOPE_ARG("shapes", "ShapeRecognizer::recognize", stroke.pts.size());
     ShapeMatch best;
     auto consider = [&](ShapeMatch m) {
         if (m.matched && (!best.matched || m.score > best.score)) best = m;
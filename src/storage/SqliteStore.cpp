@@ -1,13 +1,19 @@
 #include "SqliteStore.h"
 
+#include <QBuffer>
 #include <QDateTime>
+#include <QFuture>
+#include <QScopeGuard>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QUuid>
 #include <QVariant>
+#include <QtConcurrent>
 
+#include "export/RasterExporter.h"
 #include "model/Document.h"
+#include "trace/Trace.h"
 
 static QString lastSqlError(const QSqlDatabase& db) {
   return db.lastError().text();
@@ -47,6 +53,16 @@ static QColor unpackColorRgba(int v) {
   return QColor(r, g, b, a);
 }
 
+// Shape types come from a tiny fixed set; hand out shared literals so a
+// large document doesn't carry one string allocation per shape.
+static QString sharedShapeType(const QString& type) {
+  if (type.isEmpty()) return QString();
+  if (type == QLatin1String("line")) return QStringLiteral("line");
+  if (type == QLatin1String("circle")) return QStringLiteral("circle");
+  if (type == QLatin1String("rect")) return QStringLiteral("rect");
+  return type;
+}
+
 bool SqliteStore::ensureSchema(QString* err, const QString& connectionName) {
   auto db = QSqlDatabase::database(connectionName);
   QSqlQuery q(db);
@@ -87,6 +103,15 @@ bool SqliteStore::ensureSchema(QString* err, const QString& connectionName) {
   if (!q.prepare("CREATE INDEX IF NOT EXISTS idx_stroke_points_sid ON stroke_points(stroke_id)") || 
       !execOrErr(q, err)) return false;
 
+  // raw samples of recognized shapes (qCompress'd, see Stroke::packRawPoints);
+  // such strokes have no stroke_points rows, their outline comes from shape_params
+  if (!q.prepare("CREATE TABLE IF NOT EXISTS stroke_raw_points("
+                 "  stroke_id INTEGER PRIMARY KEY,"
+                 "  shape_pressure REAL NOT NULL,"
+                 "  data BLOB NOT NULL,"
+                 "  FOREIGN KEY(stroke_id) REFERENCES strokes(id) ON DELETE CASCADE"
+                 ")") || !execOrErr(q, err)) return false;
+
   // text boxes table
   if (!q.prepare("CREATE TABLE IF NOT EXISTS text_boxes("
                  "  id INTEGER PRIMARY KEY,"
@@ -99,6 +124,14 @@ bool SqliteStore::ensureSchema(QString* err, const QString& connectionName) {
                  "  updated_at INTEGER"
                  ")") || !execOrErr(q, err)) return false;
 
+  // PNG previews written on save; page is 0 for the infinite-canvas overview
+  if (!q.prepare("CREATE TABLE IF NOT EXISTS thumbnails("
+                 "  page INTEGER PRIMARY KEY,"
+                 "  width INTEGER NOT NULL,"
+                 "  height INTEGER NOT NULL,"
+                 "  png BLOB NOT NULL"
+                 ")") || !execOrErr(q, err)) return false;
+
   // pages table
   if (!q.prepare("CREATE TABLE IF NOT EXISTS pages("
                  "  id INTEGER PRIMARY KEY,"
@@ -109,7 +142,23 @@ bool SqliteStore::ensureSchema(QString* err, const QString& connectionName) {
   return true;
 }
 
-bool SqliteStore::saveToFile(const QString& path, const Document& doc, QString* err) {
+bool SqliteStore::saveToFile(const QString& path, const Document& doc, QString* err,
+                             const SqliteSaveOptions& opts) {
+  VELLUM_TRACE_SCOPE("storage", "SqliteStore::saveToFile");
+
+  // Previews render on a worker while the tables are written below. The
+  // worker reads `doc`, so every return waits for it first.
+  QFuture<QVector<QImage>> previews;
+  if (opts.thumbnails) {
+    PreviewOptions previewOpts;
+    previewOpts.maxSide = opts.thumbnailSize;
+    previewOpts.maxPages = opts.maxThumbnailPages;
+    previews = QtConcurrent::run([&doc, previewOpts] {
+      VELLUM_TRACE_SCOPE("storage", "render thumbnails");
+      return RasterExporter::renderPreviews(doc, previewOpts);
+    });
+  }
+  const auto waitForPreviews = qScopeGuard([&previews] { previews.waitForFinished(); });
   const QString conn = QString("vellum_%1").arg(QUuid::createUuid().toString(QUuid::Id128));
   {
     QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", conn);
@@ -135,102 +184,196 @@ bool SqliteStore::saveToFile(const QString& path, const Document& doc, QString*
 
     QSqlQuery q(db);
 
+    // Full-text index over text box markdown, rowid = text_boxes.id, rebuilt
+    // on every save and marked filled by the text_index meta key (see
+    // TextSearch). Created here rather than in ensureSchema so loading an
+    // older file doesn't leave an empty index behind. Optional: without FTS5
+    // in the SQLite build there is no index and search falls back to LIKE.
+    bool fullText = false;
+    {
+      QSqlQuery fts(db);
+      fullText = fts.prepare("CREATE VIRTUAL TABLE IF NOT EXISTS text_search USING fts5(markdown, tokenize='unicode61')") &&
+                 fts.exec();
+    }
+
     // Fix: Clean DELETE logic
     auto clearTable = [&](const QString& tableName) {
         if (!q.prepare(QString("DELETE FROM %1").arg(tableName))) return false;
         return execOrErr(q, err);
     };
 
-    if (!clearTable("stroke_points") || !clearTable("strokes") || 
-        !clearTable("text_boxes") || !clearTable("pages")) {
-      rollbackTx(db);
-      db.close();
-      QSqlDatabase::removeDatabase(conn);
-      return false;
+    {
+      VELLUM_TRACE_SCOPE("storage", "clear tables");
+      if (!clearTable("stroke_points") || !clearTable("stroke_raw_points") || !clearTable("strokes") ||
+          !clearTable("text_boxes") || !clearTable("pages") || !clearTable("thumbnails") ||
+          (fullText && !clearTable("text_search"))) {
+        rollbackTx(db);
+        db.close();
+        QSqlDatabase::removeDatabase(conn);
+        return false;
+      }
     }
 
     // meta
     const qint64 now = QDateTime::currentMSecsSinceEpoch();
     const QString viewMode = (doc.viewMode() == Document::ViewMode::A4Notebook) ? "a4" : "infinite";
+    {
+      VELLUM_TRACE_SCOPE("storage", "meta");
 
-    if (!q.prepare("INSERT OR REPLACE INTO meta(key,value) VALUES(?,?)")) {
-      rollbackTx(db);
-      db.close();
-      QSqlDatabase::removeDatabase(conn);
-      return false;
-    }
-
-    auto putMeta = [&](const QString& key, const QString& value) {
-      q.addBindValue(key);
-      q.addBindValue(value);
-      bool ok = execOrErr(q, err);
-      // Re-prepare for next call since addBindValue consumes the bound state on some drivers
-      q.prepare("INSERT OR REPLACE INTO meta(key,value) VALUES(?,?)"); 
-      return ok;
-    };
-
-    if (!putMeta("doc_version", "1") || !putMeta("view_mode", viewMode) ||
-        !putMeta("modified_at", QString::number(now))) {
-      rollbackTx(db);
-      db.close();
-      QSqlDatabase::removeDatabase(conn);
-      return false;
-    }
+      if (!q.prepare("INSERT OR REPLACE INTO meta(key,value) VALUES(?,?)")) {
+        rollbackTx(db);
+        db.close();
+        QSqlDatabase::removeDatabase(conn);
+        return false;
+      }
 
-    // strokes & points
-    QSqlQuery insStroke(db);
-    insStroke.prepare("INSERT INTO strokes(id,tool,color_rgba,base_width,is_shape,shape_type,shape_params,created_at) VALUES(?,?,?,?,?,?,?,?)");
-
-    QSqlQuery insPt(db);
-    insPt.prepare("INSERT INTO stroke_points(stroke_id,seq,x,y,pressure,t) VALUES(?,?,?,?,?,?)");
-
-    for (const auto& s : doc.strokes()) {
-      insStroke.addBindValue(s.id);
-      insStroke.addBindValue(QStringLiteral("pen"));
-      insStroke.addBindValue(packColorRgba(s.color));
-      insStroke.addBindValue(s.baseWidthPoints);
-      insStroke.addBindValue(s.isShape ? 1 : 0);
-      insStroke.addBindValue(s.shapeType);
-      insStroke.addBindValue(s.shapeParams);
-      insStroke.addBindValue(now);
-      if (!execOrErr(insStroke, err)) {
+      auto putMeta = [&](const QString& key, const QString& value) {
+        q.addBindValue(key);
+        q.addBindValue(value);
+        bool ok = execOrErr(q, err);
+        // Re-prepare for next call since addBindValue consumes the bound state on some drivers
+        q.prepare("INSERT OR REPLACE INTO meta(key,value) VALUES(?,?)"); 
+        return ok;
+      };
+
+      QSqlQuery dropIndexKey(db);
+      if (!putMeta("doc_version", "2") || !putMeta("view_mode", viewMode) ||
+          !putMeta("modified_at", QString::number(now)) ||
+          (fullText ? !putMeta("text_index", "1")
+                    : !(dropIndexKey.prepare("DELETE FROM meta WHERE key='text_index'") &&
+                        execOrErr(dropIndexKey, err)))) {
         rollbackTx(db);
         db.close();
         QSqlDatabase::removeDatabase(conn);
         return false;
       }
+    }
 
-      for (int i = 0; i < s.pts.size(); ++i) {
-        const auto& p = s.pts[i];
-        insPt.addBindValue(s.id);
-        insPt.addBindValue(i);
-        insPt.addBindValue(p.worldPos.x());
-        insPt.addBindValue(p.worldPos.y());
-        insPt.addBindValue(p.pressure);
-        insPt.addBindValue(p.tMs);
-        if (!execOrErr(insPt, err)) {
+    // strokes & points
+    {
+      VELLUM_TRACE_SCOPE_ARG("storage", "strokes", doc.strokes().size());
+      QSqlQuery insStroke(db);
+      insStroke.prepare("INSERT INTO strokes(id,tool,color_rgba,base_width,is_shape,shape_type,shape_params,created_at) VALUES(?,?,?,?,?,?,?,?)");
+
+      QSqlQuery insPt(db);
+      insPt.prepare("INSERT INTO stroke_points(stroke_id,seq,x,y,pressure,t) VALUES(?,?,?,?,?,?)");
+
+      QSqlQuery insRaw(db);
+      insRaw.prepare("INSERT INTO stroke_raw_points(stroke_id,shape_pressure,data) VALUES(?,?,?)");
+
+      for (const auto& s : doc.strokes()) {
+        insStroke.addBindValue(s.id);
+        insStroke.addBindValue(QStringLiteral("pen"));
+        insStroke.addBindValue(packColorRgba(s.color));
+        insStroke.addBindValue(s.baseWidthPoints);
+        insStroke.addBindValue(s.isShape ? 1 : 0);
+        insStroke.addBindValue(s.shapeType);
+        insStroke.addBindValue(s.shapeParams);
+        insStroke.addBindValue(now);
+        if (!execOrErr(insStroke, err)) {
           rollbackTx(db);
           db.close();
           QSqlDatabase::removeDatabase(conn);
           return false;
         }
+
+        // Recognized shapes persist only their params; the raw samples go to
+        // the side table as the already compressed blob.
+        if (s.hasPackedRawPoints()) {
+          insRaw.addBindValue(s.id);
+          insRaw.addBindValue(s.pts.isEmpty() ? 1.0 : static_cast<double>(s.pts.front().pressure));
+          insRaw.addBindValue(s.rawPointsZ);
+          if (!execOrErr(insRaw, err)) {
+            rollbackTx(db);
+            db.close();
+            QSqlDatabase::removeDatabase(conn);
+            return false;
+          }
+          continue;
+        }
+
+        for (int i = 0; i < s.pts.size(); ++i) {
+          const auto& p = s.pts[i];
+          insPt.addBindValue(s.id);
+          insPt.addBindValue(i);
+          insPt.addBindValue(p.worldPos.x());
+          insPt.addBindValue(p.worldPos.y());
+          insPt.addBindValue(p.pressure);
+          insPt.addBindValue(p.tMs);
+          if (!execOrErr(insPt, err)) {
+            rollbackTx(db);
+            db.close();
+            QSqlDatabase::removeDatabase(conn);
+            return false;
+          }
+        }
       }
     }
 
     // text boxes
-    QSqlQuery insText(db);
-    insText.prepare("INSERT INTO text_boxes(id,x,y,w,h,markdown,created_at,updated_at) VALUES(?,?,?,?,?,?,?,?)");
-
-    for (const auto& t : doc.textBoxes()) {
-      insText.addBindValue(t.id);
-      insText.addBindValue(t.rectWorld.x());
-      insText.addBindValue(t.rectWorld.y());
-      insText.addBindValue(t.rectWorld.width());
-      insText.addBindValue(t.rectWorld.height());
-      insText.addBindValue(t.markdown);
-      insText.addBindValue(now);
-      insText.addBindValue(now);
-      if (!execOrErr(insText, err)) {
+    {
+      VELLUM_TRACE_SCOPE_ARG("storage", "text_boxes", doc.textBoxes().size());
+      QSqlQuery insText(db);
+      insText.prepare("INSERT INTO text_boxes(id,x,y,w,h,markdown,created_at,updated_at) VALUES(?,?,?,?,?,?,?,?)");
+
+      QSqlQuery insSearch(db);
+      if (fullText) insSearch.prepare("INSERT INTO text_search(rowid,markdown) VALUES(?,?)");
+
+      for (const auto& t : doc.textBoxes()) {
+        insText.addBindValue(t.id);
+        insText.addBindValue(t.rectWorld.x());
+        insText.addBindValue(t.rectWorld.y());
+        insText.addBindValue(t.rectWorld.width());
+        insText.addBindValue(t.rectWorld.height());
+        insText.addBindValue(t.markdown);
+        insText.addBindValue(now);
+        insText.addBindValue(now);
+        if (!execOrErr(insText, err)) {
+          rollbackTx(db);
+          db.close();
+          QSqlDatabase::removeDatabase(conn);
+          return false;
+        }
+
+        if (!fullText || t.markdown.isEmpty()) continue;
+        insSearch.addBindValue(t.id);
+        insSearch.addBindValue(t.markdown);
+        if (!execOrErr(insSearch, err)) {
+          rollbackTx(db);
+          db.close();
+          QSqlDatabase::removeDatabase(conn);
+          return false;
+        }
+      }
+    }
+
+    // thumbnails
+    if (opts.thumbnails) {
+      const QVector<QImage> images = previews.result();
+      VELLUM_TRACE_SCOPE_ARG("storage", "thumbnails", images.size());
+      QSqlQuery insThumb(db);
+      insThumb.prepare("INSERT INTO thumbnails(page,width,height,png) VALUES(?,?,?,?)");
+      for (int page = 0; page < images.size(); ++page) {
+        QByteArray png;
+        QBuffer buf(&png);
+        buf.open(QIODevice::WriteOnly);
+        images[page].save(&buf, "PNG");
+        insThumb.addBindValue(page);
+        insThumb.addBindValue(images[page].width());
+        insThumb.addBindValue(images[page].height());
+        insThumb.addBindValue(png);
+        if (!execOrErr(insThumb, err)) {
+          rollbackTx(db);
+          db.close();
+          QSqlDatabase::removeDatabase(conn);
+          return false;
+        }
+      }
+    }
+
+    {
+      VELLUM_TRACE_SCOPE("storage", "commit");
+      if (!commitTx(db, err)) {
         rollbackTx(db);
         db.close();
         QSqlDatabase::removeDatabase(conn);
@@ -238,13 +381,6 @@ bool SqliteStore::saveToFile(const QString& path, const Document& doc, QString*
       }
     }
 
-    if (!commitTx(db, err)) {
-      rollbackTx(db);
-      db.close();
-      QSqlDatabase::removeDatabase(conn);
-      return false;
-    }
-
     db.close();
   }
   QSqlDatabase::removeDatabase(conn);
@@ -252,6 +388,7 @@ bool SqliteStore::saveToFile(const QString& path, const Document& doc, QString*
 }
 
 bool SqliteStore::loadFromFile(const QString& path, Document* doc, QString* err) {
+  VELLUM_TRACE_SCOPE("storage", "SqliteStore::loadFromFile");
   if (!doc) {
     if (err) *err = "Document is null";
     return false;
@@ -279,45 +416,66 @@ bool SqliteStore::loadFromFile(const QString& path, Document* doc, QString* err)
     // meta view mode
     QString viewMode = "infinite";
     {
+      VELLUM_TRACE_SCOPE("storage", "meta");
       QSqlQuery q(db);
       if (q.prepare("SELECT value FROM meta WHERE key='view_mode'") && execOrErr(q, err)) {
           if (q.next()) viewMode = q.value(0).toString();
       }
     }
 
+    // Listeners see one reset and one changed() for the whole load.
+    doc->beginBatch();
     doc->clear();
     doc->setViewMode(viewMode == "a4" ? Document::ViewMode::A4Notebook : Document::ViewMode::Infinite);
 
     // strokes
     {
+      VELLUM_TRACE_SCOPE("storage", "strokes");
       QSqlQuery q(db);
-      if (q.prepare("SELECT id,color_rgba,base_width,is_shape,shape_type,shape_params FROM strokes ORDER BY id") && 
+      if (q.prepare("SELECT s.id,s.color_rgba,s.base_width,s.is_shape,s.shape_type,s.shape_params,"
+                    "r.shape_pressure,r.data "
+                    "FROM strokes s LEFT JOIN stroke_raw_points r ON r.stroke_id=s.id ORDER BY s.id") && 
           execOrErr(q, err)) {
         
+        // One prepared point query and one scratch buffer for all strokes;
+        // the points end up in the document's arena.
+        QSqlQuery qp(db);
+        const bool pointsOk =
+            qp.prepare("SELECT x,y,pressure,t FROM stroke_points WHERE stroke_id=? ORDER BY seq");
+        StrokePoints scratch;
         while (q.next()) {
           Stroke s;
           s.id = q.value(0).toLongLong();
           s.color = unpackColorRgba(q.value(1).toInt());
           s.baseWidthPoints = q.value(2).toDouble();
           s.isShape = q.value(3).toInt() != 0;
-          s.shapeType = q.value(4).toString();
+          s.shapeType = sharedShapeType(q.value(4).toString());
           s.shapeParams = q.value(5).toByteArray();
 
           maxStrokeId = std::max(maxStrokeId, s.id);
 
+          // shape with packed raw samples: rebuild the outline, stroke_points is empty
+          if (s.isShape && !q.value(7).isNull()) {
+            s.rawPointsZ = q.value(7).toByteArray();
+            s.pts = s.shapeOutline(static_cast<float>(q.value(6).toDouble()));
+            if (s.pts.size() < 2) s.unpackRawPoints();
+            doc->insertStroke(-1, std::move(s));
+            continue;
+          }
+
           // points
-          QSqlQuery qp(db);
-          qp.prepare("SELECT x,y,pressure,t FROM stroke_points WHERE stroke_id=? ORDER BY seq");
-          qp.addBindValue(s.id);
-          if (execOrErr(qp, err)) {
+          scratch.clear();
+          qp.bindValue(0, s.id);
+          if (pointsOk && execOrErr(qp, err)) {
               while (qp.next()) {
                 const double x = qp.value(0).toDouble();
                 const double y = qp.value(1).toDouble();
                 const float pr = static_cast<float>(qp.value(2).toDouble());
                 const qint64 t = qp.value(3).toLongLong();
-                s.pts.push_back(StrokePoint{QPointF(x, y), pr, t});
+                scratch.append(QPointF(x, y), pr, t);
               }
           }
+          s.pts = doc->internPoints(scratch);
           doc->insertStroke(-1, std::move(s));
         }
       }
@@ -325,6 +483,7 @@ bool SqliteStore::loadFromFile(const QString& path, Document* doc, QString* err)
 
     // text boxes
     {
+      VELLUM_TRACE_SCOPE("storage", "text_boxes");
       QSqlQuery q(db);
       if (q.prepare("SELECT id,x,y,w,h,markdown FROM text_boxes ORDER BY id") && execOrErr(q, err)) {
           while (q.next()) {
@@ -341,8 +500,42 @@ bool SqliteStore::loadFromFile(const QString& path, Document* doc, QString* err)
     }
 
     doc->setNextIds(maxStrokeId + 1, maxTextId + 1);
+    doc->endBatch();
     db.close();
   }
   QSqlDatabase::removeDatabase(conn);
   return true;
-}
\ No newline at end of file
+}
+
+QImage SqliteStore::readThumbnail(const QString& path, int page, QString* err) {
+  VELLUM_TRACE_SCOPE("storage", "SqliteStore::readThumbnail");
+  const QString conn = QString("vellum_%1").arg(QUuid::createUuid().toString(QUuid::Id128));
+  QImage img;
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", conn);
+    db.setDatabaseName(path);
+    db.setConnectOptions("QSQLITE_OPEN_READONLY");
+    if (!db.open()) {
+      if (err) *err = db.lastError().text();
+      QSqlDatabase::removeDatabase(conn);
+      return img;
+    }
+
+    // No ensureSchema(): a read-only open must not create tables, and files
+    // saved before thumbnails existed simply fail the prepare.
+    QSqlQuery q(db);
+    if (q.prepare("SELECT png FROM thumbnails WHERE page=?")) {
+      q.addBindValue(page);
+      if (execOrErr(q, err) && q.next()) {
+        img.loadFromData(q.value(0).toByteArray(), "PNG");
+      } else if (err && err->isEmpty()) {
+        *err = QString("No thumbnail for page %1").arg(page);
+      }
+    } else if (err) {
+      *err = "File has no thumbnails";
+    }
+    db.close();
+  }
+  QSqlDatabase::removeDatabase(conn);
+  return img;
+}
@@ -1,14 +1,30 @@
 #pragma once
 
+#include <QImage>
 #include <QString>
 
 class Document;
 
+struct SqliteSaveOptions {
+  // Store PNG previews (see RasterExporter::renderPreviews) for
+  // readThumbnail(). They are rendered on a worker thread while the
+  // strokes are written.
+  bool thumbnails = true;
+  int thumbnailSize = 256;      // px, longest edge
+  int maxThumbnailPages = 32;
+};
+
 class SqliteStore {
  public:
-  static bool saveToFile(const QString& path, const Document& doc, QString* err);
+  static bool saveToFile(const QString& path, const Document& doc, QString* err,
+                         const SqliteSaveOptions& opts = SqliteSaveOptions());
   static bool loadFromFile(const QString& path, Document* doc, QString* err);
 
+  // Preview of `page` (0 in infinite mode) stored by the last save. Opens
+  // the file read-only and reads only the thumbnails table, so it's cheap
+  // enough for file browsers and galleries. Null if the file has none.
+  static QImage readThumbnail(const QString& path, int page = 0, QString* err = nullptr);
+
  private:
   static bool ensureSchema(QString* err, const QString& connectionName);
 };
@@ -0,0 +1,136 @@
+#include "TextSearch.h"
+
+#include <QDirIterator>
+#include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QUuid>
+#include <QVariant>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+#include "trace/Trace.h"
+
+static QStringList queryWords(const QString& query) {
+  static const QRegularExpression kSeparators("[^\\w]+", QRegularExpression::UseUnicodePropertiesOption);
+  return query.split(kSeparators, Qt::SkipEmptyParts);
+}
+
+QString TextSearch::toMatchExpression(const QString& query) {
+  const QStringList words = queryWords(query);
+  QStringList terms;
+  for (const QString& w : words) terms << QString("\"%1\"").arg(QString(w).replace('"', "\"\""));
+  if (!terms.isEmpty()) terms.last() += '*';
+  return terms.join(' ');
+}
+
+// Saves that fill text_search also set meta.text_index; a table without
+// the key may be empty (created by an older build when merely opening the
+// file), so it isn't trusted.
+static bool hasFilledIndex(const QSqlDatabase& db) {
+  QSqlQuery q(db);
+  return q.prepare("SELECT 1 FROM meta WHERE key='text_index' AND value='1'") && q.exec() && q.next();
+}
+
+// Text around the first occurrence of any word, for files without the
+// index (FTS5's snippet() does this otherwise).
+static QString likeSnippet(const QString& text, const QStringList& words) {
+  constexpr int kContext = 30;
+  for (const QString& w : words) {
+    const qsizetype at = text.indexOf(w, 0, Qt::CaseInsensitive);
+    if (at < 0) continue;
+    const qsizetype from = std::max<qsizetype>(0, at - kContext);
+    return (from > 0 ? "…" : "") + text.mid(from, at - from) + '[' + text.mid(at, w.size()) + ']' +
+           text.mid(at + w.size(), kContext) + (at + w.size() + kContext < text.size() ? "…" : "");
+  }
+  return text.left(2 * kContext);
+}
+
+QVector<TextSearchHit> TextSearch::searchFile(const QString& path, const QString& query, QString* err,
+                                              const TextSearchOptions& opts) {
+  VELLUM_TRACE_SCOPE("storage", "TextSearch::searchFile");
+  QVector<TextSearchHit> hits;
+  const QStringList words = queryWords(query);
+  if (words.isEmpty()) return hits;
+
+  const QString conn = QString("vellum_search_%1").arg(QUuid::createUuid().toString(QUuid::Id128));
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", conn);
+    db.setDatabaseName(path);
+    db.setConnectOptions("QSQLITE_OPEN_READONLY");
+    if (!db.open()) {
+      if (err) *err = db.lastError().text();
+      QSqlDatabase::removeDatabase(conn);
+      return hits;
+    }
+
+    QSqlQuery q(db);
+    bool ok = false;
+    const bool fullText = hasFilledIndex(db);
+    if (fullText) {
+      ok = q.prepare("SELECT t.id,t.x,t.y,t.w,t.h,snippet(text_search,0,'[',']','…',12),bm25(text_search) "
+                     "FROM text_search JOIN text_boxes t ON t.id=text_search.rowid "
+                     "WHERE text_search MATCH ? ORDER BY bm25(text_search) LIMIT ?");
+      q.addBindValue(toMatchExpression(query));
+      q.addBindValue(opts.maxHitsPerFile);
+    } else {
+      QStringList where;
+      for (qsizetype i = 0; i < words.size(); ++i) where << "markdown LIKE ? ESCAPE '\\'";
+      ok = q.prepare("SELECT id,x,y,w,h,markdown FROM text_boxes WHERE " + where.join(" AND ") +
+                     " ORDER BY id LIMIT ?");
+      for (QString w : words) {
+        w.replace('\\', "\\\\").replace('%', "\\%").replace('_', "\\_");
+        q.addBindValue("%" + w + "%");
+      }
+      q.addBindValue(opts.maxHitsPerFile);
+    }
+
+    if (!ok || !q.exec()) {
+      if (err) *err = q.lastError().text();
+    } else {
+      while (q.next()) {
+        TextSearchHit h;
+        h.path = path;
+        h.textBoxId = q.value(0).toLongLong();
+        h.rect = QRectF(q.value(1).toDouble(), q.value(2).toDouble(), q.value(3).toDouble(), q.value(4).toDouble());
+        h.snippet = fullText ? q.value(5).toString() : likeSnippet(q.value(5).toString(), words);
+        h.rank = fullText ? q.value(6).toDouble() : 0.0;
+        hits.push_back(h);
+      }
+    }
+    db.close();
+  }
+  QSqlDatabase::removeDatabase(conn);
+  return hits;
+}
+
+QVector<TextSearchHit> TextSearch::searchDirectory(const QString& dirPath, const QString& query,
+                                                   const TextSearchOptions& opts) {
+  VELLUM_TRACE_SCOPE("storage", "TextSearch::searchDirectory");
+  QStringList files;
+  QDirIterator it(dirPath, {"*.vellum"}, QDir::Files,
+                  opts.recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+  while (it.hasNext()) files << it.next();
+  if (files.isEmpty() || queryWords(query).isEmpty()) return {};
+
+  // One connection per file and worker; SQLite handles the rest.
+  const QVector<QVector<TextSearchHit>> perFile = QtConcurrent::blockingMapped<QVector<QVector<TextSearchHit>>>(
+      files, [&](const QString& path) { return searchFile(path, query, nullptr, opts); });
+
+  // bm25 depends on each file's own term statistics, so scores from
+  // different files don't compare. Interleave instead: every file's best
+  // hit, then every file's second best, and so on.
+  QVector<TextSearchHit> hits;
+  for (qsizetype place = 0; hits.size() < opts.maxHits; ++place) {
+    bool more = false;
+    for (const auto& fileHits : perFile) {
+      if (place >= fileHits.size()) continue;
+      more = true;
+      if (hits.size() < opts.maxHits) hits.push_back(fileHits[place]);
+    }
+    if (!more) break;
+  }
+  return hits;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QRectF>
+#include <QString>
+#include <QVector>
+
+// One text box matching a query.
+struct TextSearchHit {
+  QString path;  // .vellum file
+  qint64 textBoxId = -1;
+  QRectF rect;      // world rect, for CanvasWidget::centerOn()
+  QString snippet;  // matching text with the hit in [brackets]
+  double rank = 0;  // FTS5 bm25 within its file, lower is better; 0 for LIKE fallback hits
+};
+
+struct TextSearchOptions {
+  int maxHitsPerFile = 20;
+  int maxHits = 200;
+  bool recursive = true;  // searchDirectory: descend into subdirectories
+};
+
+// Searches text box markdown through the text_search FTS5 index the store
+// keeps in sync on save. Files open read-only and only the text tables are
+// read, so searching an archive never loads strokes. Files saved without
+// the index (older files, SQLite without FTS5) are scanned with LIKE.
+//
+// Queries are plain words, not FTS5 syntax: every word must appear, and
+// the last one also matches as a prefix, so results update while typing.
+class TextSearch {
+ public:
+  static QVector<TextSearchHit> searchFile(const QString& path, const QString& query, QString* err = nullptr,
+                                           const TextSearchOptions& opts = TextSearchOptions());
+  // Every *.vellum file under `dirPath`, searched in parallel. Hits are
+  // interleaved by their place within their file (ranks from different
+  // files don't compare). Unreadable files are skipped.
+  static QVector<TextSearchHit> searchDirectory(const QString& dirPath, const QString& query,
+                                                const TextSearchOptions& opts = TextSearchOptions());
+
+  // The FTS5 MATCH expression for `query`; empty if it has no words.
+  static QString toMatchExpression(const QString& query);
+};
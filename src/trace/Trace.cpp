@@ -0,0 +1,178 @@
+#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+struct Event {
+  const char* category = nullptr;
+  const char* name = nullptr;
+  qint64 startNs = 0;
+  qint64 durNs = -1;  // -1: instant event
+  qint64 arg = Tracer::kNoArg;
+  quint32 tid = 0;
+};
+
+struct State {
+  QMutex mutex;
+  QVector<Event> ring = QVector<Event>(64 * 1024);
+  qsizetype next = 0;
+  qsizetype count = 0;
+  QHash<quint32, QString> threadNames;
+  QElapsedTimer clock;
+  State() { clock.start(); }
+};
+
+std::atomic<bool> g_enabled{false};
+std::atomic<quint32> g_nextTid{1};
+
+State& state() {
+  static State s;
+  return s;
+}
+
+// Small, stable per-thread ids; the thread's name is recorded on first use.
+quint32 currentTid() {
+  thread_local quint32 tid = 0;
+  if (tid == 0) {
+    tid = g_nextTid.fetch_add(1);
+    QThread* t = QThread::currentThread();
+    QString name = t ? t->objectName() : QString();
+    if (name.isEmpty()) {
+      const bool isMain = QCoreApplication::instance() && t == QCoreApplication::instance()->thread();
+      name = isMain ? QStringLiteral("main") : QStringLiteral("thread %1").arg(tid);
+    }
+    State& s = state();
+    QMutexLocker lock(&s.mutex);
+    s.threadNames.insert(tid, name);
+  }
+  return tid;
+}
+
+void push(const Event& e) {
+  State& s = state();
+  QMutexLocker lock(&s.mutex);
+  s.ring[s.next] = e;
+  s.next = (s.next + 1) % s.ring.size();
+  s.count = std::min(s.count + 1, s.ring.size());
+}
+
+}  // namespace
+
+void Tracer::setEnabled(bool enabled) {
+  state();  // start the clock before the first span
+  g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Tracer::isEnabled() {
+  return g_enabled.load(std::memory_order_relaxed);
+}
+
+void Tracer::setCapacity(int events) {
+  State& s = state();
+  QMutexLocker lock(&s.mutex);
+  s.ring = QVector<Event>(std::max(1, events));
+  s.next = 0;
+  s.count = 0;
+}
+
+QString Tracer::startFromEnvironment() {
+  const QString path = qEnvironmentVariable("VELLUM_TRACE");
+  if (!path.isEmpty()) setEnabled(true);
+  return path;
+}
+
+qint64 Tracer::nowNs() {
+  return state().clock.nsecsElapsed();
+}
+
+void Tracer::complete(const char* category, const char* name, qint64 startNs, qint64 durNs, qint64 arg) {
+  Event e;
+  e.category = category;
+  e.name = name;
+  e.startNs = startNs;
+  e.durNs = std::max<qint64>(0, durNs);
+  e.arg = arg;
+  e.tid = currentTid();
+  push(e);
+}
+
+void Tracer::instant(const char* category, const char* name) {
+  Event e;
+  e.category = category;
+  e.name = name;
+  e.startNs = nowNs();
+  e.tid = currentTid();
+  push(e);
+}
+
+void Tracer::clear() {
+  State& s = state();
+  QMutexLocker lock(&s.mutex);
+  s.next = 0;
+  s.count = 0;
+}
+
+bool Tracer::writeChromeTrace(const QString& path, QString* err) {
+  QVector<Event> events;
+  QHash<quint32, QString> names;
+  {
+    State& s = state();
+    QMutexLocker lock(&s.mutex);
+    events.reserve(s.count);
+    const qsizetype first = (s.next - s.count + s.ring.size()) % s.ring.size();
+    for (qsizetype i = 0; i < s.count; ++i) events.push_back(s.ring[(first + i) % s.ring.size()]);
+    names = s.threadNames;
+    s.next = 0;
+    s.count = 0;
+  }
+
+  const qint64 pid = QCoreApplication::applicationPid();
+  QJsonArray out;
+  for (auto it = names.cbegin(); it != names.cend(); ++it) {
+    out.append(QJsonObject{{"name", "thread_name"},
+                           {"ph", "M"},
+                           {"pid", pid},
+                           {"tid", qint64(it.key())},
+                           {"args", QJsonObject{{"name", it.value()}}}});
+  }
+  for (const Event& e : events) {
+    QJsonObject o;
+    o["name"] = e.name;
+    o["cat"] = e.category;
+    o["pid"] = pid;
+    o["tid"] = qint64(e.tid);
+    o["ts"] = e.startNs / 1000.0;
+    if (e.durNs < 0) {
+      o["ph"] = "i";
+      o["s"] = "t";
+    } else {
+      o["ph"] = "X";
+      o["dur"] = e.durNs / 1000.0;
+    }
+    if (e.arg != kNoArg) o["args"] = QJsonObject{{"arg", e.arg}};
+    out.append(o);
+  }
+
+  QSaveFile f(path);
+  if (!f.open(QIODevice::WriteOnly)) {
+    if (err) *err = f.errorString();
+    return false;
+  }
+  f.write(QJsonDocument(QJsonObject{{"traceEvents", out}, {"displayTimeUnit", "ms"}}).toJson(QJsonDocument::Compact));
+  if (f.commit()) return true;
+  if (err) *err = f.errorString();
+  return false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QString>
+
+#include <limits>
+
+// Scoped tracing spans written as Chrome trace JSON (chrome://tracing,
+// Perfetto). Events go to a fixed-size in-memory ring and are only written
+// out by Tracer::writeChromeTrace(), so leaving tracing on costs a clock
+// read and a short lock per span. Recording is off until setEnabled(true);
+// building with VELLUM_TRACING=0 removes the macros entirely.
+//
+// Names and categories must be string literals; only the pointers are kept.
+
+class Tracer {
+ public:
+  static constexpr qint64 kNoArg = std::numeric_limits<qint64>::min();
+
+  static void setEnabled(bool enabled);
+  static bool isEnabled();
+  // Drops recorded events. Default capacity is 64k events.
+  static void setCapacity(int events);
+
+  // Enables tracing if VELLUM_TRACE is set and returns its value (the file
+  // to write on exit), else an empty string.
+  static QString startFromEnvironment();
+
+  static qint64 nowNs();
+  static void complete(const char* category, const char* name, qint64 startNs, qint64 durNs, qint64 arg = kNoArg);
+  static void instant(const char* category, const char* name);
+
+  // Writes everything in the ring, oldest first, and empties it.
+  static bool writeChromeTrace(const QString& path, QString* err);
+  static void clear();
+};
+
+class TraceScope {
+ public:
+  TraceScope(const char* category, const char* name, qint64 arg = Tracer::kNoArg)
+      : category_(category), name_(name), arg_(arg), startNs_(Tracer::isEnabled() ? Tracer::nowNs() : -1) {}
+  ~TraceScope() {
+    if (startNs_ >= 0) Tracer::complete(category_, name_, startNs_, Tracer::nowNs() - startNs_, arg_);
+  }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* category_;
+  const char* name_;
+  qint64 arg_;
+  qint64 startNs_;
+};
+
+#ifndef VELLUM_TRACING
+#define VELLUM_TRACING 1
+#endif
+
+#if VELLUM_TRACING
+#define VELLUM_TRACE_CONCAT_(a, b) a##b
+#define VELLUM_TRACE_CONCAT(a, b) VELLUM_TRACE_CONCAT_(a, b)
+#define VELLUM_TRACE_SCOPE(category, name) TraceScope VELLUM_TRACE_CONCAT(vellumTraceScope_, __LINE__)(category, name)
+// Same, with an integer shown as the span's "arg" (a page index, a count).
+#define VELLUM_TRACE_SCOPE_ARG(category, name, value) \
+  TraceScope VELLUM_TRACE_CONCAT(vellumTraceScope_, __LINE__)(category, name, qint64(value))
+#define VELLUM_TRACE_INSTANT(category, name) \
+  do {                                       \
+    if (Tracer::isEnabled()) Tracer::instant(category, name); \
+  } while (0)
+#else
+#define VELLUM_TRACE_SCOPE(category, name) (void)0
+#define VELLUM_TRACE_SCOPE_ARG(category, name, value) (void)0
+#define VELLUM_TRACE_INSTANT(category, name) (void)0
+#endif